@@ -0,0 +1,275 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "chip8.h"
+
+#define CHIP8_BENCH_INSTRUCTIONS 10000000 /* Default instructions per ROM */
+
+// Built by `make aot-bench` with a program translated by chip8-recompile linked in
+#ifdef CHIP8_BENCH_AOT
+extern const Chip8_Aot CHIP8_BENCH_AOT;
+#endif
+
+typedef enum Chip8_Bench_Format {
+    CHIP8_BENCH_TEXT = 0,
+    CHIP8_BENCH_CSV,
+    CHIP8_BENCH_JSON,
+} Chip8_Bench_Format;
+
+typedef struct Chip8_Bench_Result {
+    const char *rom_path;
+    uint64_t instructions;
+    uint64_t draws;
+    uint64_t restarts;  // Times the ROM halted and was reloaded to fill the budget
+    double   seconds;
+} Chip8_Bench_Result;
+
+static double chip8_bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Run a ROM unthrottled for `budget` instructions.
+// The timers still tick every 700/60 instructions so delay loops behave like they would in real time.
+// A ROM that halts (unknown opcode, end of program) is reloaded until the budget is spent.
+static bool chip8_bench_rom(const char *rom_path, Chip8_Engine engine, uint64_t budget, Chip8_Bench_Result *result)
+{
+    static Chip8_CPU initial = {0};
+    static Chip8_CPU cpu     = {0};
+
+    chip8_reset(&initial);
+    if (!chip8_read_file_into_memory(&initial, rom_path)) return false;
+    initial.chip8_engine = engine;
+#ifdef CHIP8_BENCH_AOT
+    if (!chip8_aot_attach(&initial, &CHIP8_BENCH_AOT)) return false;
+#endif
+
+    memset(result, 0, sizeof(*result));
+    result->rom_path = rom_path;
+
+    cpu = initial; // chip8_reset seeds CXKK, every run draws the same sequence
+
+    uint64_t executed = 0;
+    uint64_t frames   = 0;
+    double start = chip8_bench_now();
+    while (executed < budget) {
+        frames++;
+        uint64_t frame_end = (uint64_t)((double)frames * CHIP8_CPU_HZ / CHIP8_TIMER_HZ);
+        if (frame_end > budget) frame_end = budget;
+
+        uint64_t before = cpu.chip8_cycles;
+        Chip8_Status status = chip8_run_cycles(&cpu, frame_end - executed);
+        executed += cpu.chip8_cycles - before;
+
+        if (status != CHIP8_OK) {
+            result->draws += cpu.chip8_draws;
+            result->restarts++;
+            cpu = initial;
+            // Count the faulting instruction so a ROM that halts immediately still makes progress
+            executed++;
+            frames = (uint64_t)((double)executed * CHIP8_TIMER_HZ / CHIP8_CPU_HZ);
+            continue;
+        }
+        chip8_tick_timers(&cpu);
+    }
+    result->seconds = chip8_bench_now() - start;
+    result->draws  += cpu.chip8_draws;
+    result->instructions = executed;
+    return true;
+}
+
+// Same as chip8_bench_rom for CHIP8_BATCH_LANES copies of the ROM seeded 1, 2, ... in one Chip8_Batch.
+// `budget` is split between the lanes. A lane that halts is reloaded with its seed, the others go on
+static bool chip8_bench_batch(const char *rom_path, Chip8_Engine engine, uint64_t budget, Chip8_Bench_Result *result)
+{
+    static Chip8_CPU   initial = {0};
+    static Chip8_Batch batch   = {0};
+
+    chip8_reset(&initial);
+    if (!chip8_read_file_into_memory(&initial, rom_path)) return false;
+    initial.chip8_engine = engine;
+
+    memset(result, 0, sizeof(*result));
+    result->rom_path = rom_path;
+
+    for (uint32_t i = 0; i < CHIP8_BATCH_LANES; ++i) {
+        batch.cpus[i] = initial;
+        chip8_seed_random(&batch.cpus[i], i + 1);
+    }
+    if (!chip8_batch_begin(&batch, CHIP8_BATCH_LANES)) return false;
+
+    uint64_t lane_budget = (budget + CHIP8_BATCH_LANES - 1) / CHIP8_BATCH_LANES;
+    uint64_t scheduled   = 0;
+    uint64_t frames      = 0;
+    double start = chip8_bench_now();
+    while (scheduled < lane_budget) {
+        frames++;
+        uint64_t frame_end = (uint64_t)((double)frames * CHIP8_CPU_HZ / CHIP8_TIMER_HZ);
+        if (frame_end > lane_budget) frame_end = lane_budget;
+
+        Chip8_Status status = chip8_batch_run(&batch, frame_end - scheduled);
+        scheduled = frame_end;
+
+        if (status != CHIP8_OK) {
+            chip8_batch_sync(&batch);
+            for (uint32_t i = 0; i < CHIP8_BATCH_LANES; ++i) {
+                if (batch.status[i] == CHIP8_OK) continue;
+                result->instructions += batch.cpus[i].chip8_cycles;
+                result->draws        += batch.cpus[i].chip8_draws;
+                result->restarts++;
+                batch.cpus[i] = initial;
+                chip8_seed_random(&batch.cpus[i], i + 1);
+            }
+            if (!chip8_batch_begin(&batch, CHIP8_BATCH_LANES)) return false;
+        }
+        chip8_batch_tick_timers(&batch);
+    }
+    result->seconds = chip8_bench_now() - start;
+
+    chip8_batch_sync(&batch);
+    for (uint32_t i = 0; i < CHIP8_BATCH_LANES; ++i) {
+        result->instructions += batch.cpus[i].chip8_cycles;
+        result->draws        += batch.cpus[i].chip8_draws;
+    }
+    return true;
+}
+
+static void chip8_bench_print_header(Chip8_Bench_Format format)
+{
+    switch (format) {
+    case CHIP8_BENCH_TEXT:
+        printf("%-36s %12s %12s %10s %14s %9s\n", "ROM", "Instructions", "Instr/sec", "ns/Instr", "Draws/sec", "Restarts");
+        break;
+    case CHIP8_BENCH_CSV:
+        printf("rom,instructions,seconds,instructions_per_sec,ns_per_instruction,draws,draws_per_sec,restarts\n");
+        break;
+    case CHIP8_BENCH_JSON:
+        printf("[\n");
+        break;
+    }
+}
+
+// Print `s` as a JSON string, quotes included
+static void chip8_bench_print_json_string(const char *s)
+{
+    putchar('"');
+    for (; *s != '\0'; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') printf("\\%c", c);
+        else if (c < 0x20) printf("\\u%04x", c);
+        else putchar(c);
+    }
+    putchar('"');
+}
+
+static void chip8_bench_print_result(Chip8_Bench_Format format, const Chip8_Bench_Result *r, bool first)
+{
+    double ips = r->seconds > 0.0 ? (double)r->instructions / r->seconds : 0.0;
+    double ns  = r->instructions > 0 ? r->seconds * 1e9 / (double)r->instructions : 0.0;
+    double dps = r->seconds > 0.0 ? (double)r->draws / r->seconds : 0.0;
+
+    switch (format) {
+    case CHIP8_BENCH_TEXT:
+        printf("%-36s %12lu %12.0f %10.2f %14.0f %9lu\n",
+               r->rom_path, (unsigned long)r->instructions, ips, ns, dps, (unsigned long)r->restarts);
+        break;
+    case CHIP8_BENCH_CSV:
+        printf("%s,%lu,%.6f,%.0f,%.3f,%lu,%.0f,%lu\n",
+               r->rom_path, (unsigned long)r->instructions, r->seconds, ips, ns,
+               (unsigned long)r->draws, dps, (unsigned long)r->restarts);
+        break;
+    case CHIP8_BENCH_JSON:
+        printf("%s  {\"rom\": ", first ? "" : ",\n");
+        chip8_bench_print_json_string(r->rom_path);
+        printf(", \"instructions\": %lu, \"seconds\": %.6f, \"instructions_per_sec\": %.0f, "
+               "\"ns_per_instruction\": %.3f, \"draws\": %lu, \"draws_per_sec\": %.0f, \"restarts\": %lu}",
+               (unsigned long)r->instructions, r->seconds, ips, ns,
+               (unsigned long)r->draws, dps, (unsigned long)r->restarts);
+        break;
+    }
+}
+
+static void chip8_bench_print_footer(Chip8_Bench_Format format)
+{
+    if (format == CHIP8_BENCH_JSON) printf("\n]\n");
+}
+
+static void chip8_bench_usage(const char *program_name)
+{
+    fprintf(stderr, "[Usage] %s [--instructions <n>] [--engine <name>] [--batch] [--csv | --json] <rom>...\n", program_name);
+    fprintf(stderr, "    --instructions <n>  Instructions to run per ROM (default %d)\n", CHIP8_BENCH_INSTRUCTIONS);
+    fprintf(stderr, "    --engine <name>     Interpreter engine:");
+    for (int i = 0; i < CHIP8_ENGINE_COUNT; ++i) fprintf(stderr, " %s", chip8_engine_name((Chip8_Engine)i));
+    fprintf(stderr, "\n");
+    fprintf(stderr, "    --batch             Run %d copies of each ROM, seeded 1 to %d, side by side\n",
+            CHIP8_BATCH_LANES, CHIP8_BATCH_LANES);
+    fprintf(stderr, "    --csv, --json       Machine-readable output\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *program_name = argv[0];
+    Chip8_Bench_Format format = CHIP8_BENCH_TEXT;
+    uint64_t budget = CHIP8_BENCH_INSTRUCTIONS;
+    Chip8_Engine engine = CHIP8_ENGINE_CACHED;
+    bool batch = false;
+
+    int first_rom = 1;
+    for (; first_rom < argc && strncmp(argv[first_rom], "--", 2) == 0; ++first_rom) {
+        const char *arg = argv[first_rom];
+        if (strcmp(arg, "--csv") == 0) {
+            format = CHIP8_BENCH_CSV;
+        } else if (strcmp(arg, "--json") == 0) {
+            format = CHIP8_BENCH_JSON;
+        } else if (strcmp(arg, "--batch") == 0) {
+            batch = true;
+        } else if (strcmp(arg, "--engine") == 0 && first_rom + 1 < argc) {
+            if (!chip8_parse_engine(argv[++first_rom], &engine)) {
+                fprintf(stderr, "[ERROR] Unknown engine `%s`\n", argv[first_rom]);
+                return 1;
+            }
+        } else if (strcmp(arg, "--instructions") == 0 && first_rom + 1 < argc) {
+            char *end = NULL;
+            errno = 0;
+            budget = strtoull(argv[++first_rom], &end, 10);
+            if (errno != 0 || *end != '\0' || budget == 0) {
+                fprintf(stderr, "[ERROR] Invalid instruction count `%s`\n", argv[first_rom]);
+                return 1;
+            }
+        } else {
+            chip8_bench_usage(program_name);
+            return 1;
+        }
+    }
+
+    if (first_rom >= argc) {
+        chip8_bench_usage(program_name);
+        return 1;
+    }
+
+    chip8_bench_print_header(format);
+    Chip8_Bench_Result total = { .rom_path = "TOTAL" };
+    for (int i = first_rom; i < argc; ++i) {
+        Chip8_Bench_Result result;
+        bool ok = batch ? chip8_bench_batch(argv[i], engine, budget, &result)
+                        : chip8_bench_rom(argv[i], engine, budget, &result);
+        if (!ok) return 1;
+        chip8_bench_print_result(format, &result, i == first_rom);
+
+        total.instructions += result.instructions;
+        total.draws        += result.draws;
+        total.restarts     += result.restarts;
+        total.seconds      += result.seconds;
+    }
+    if (format == CHIP8_BENCH_TEXT) chip8_bench_print_result(format, &total, false);
+    chip8_bench_print_footer(format);
+    return 0;
+}
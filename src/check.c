@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "chip8.h"
+
+#define CHIP8_CHECK_FRAMES 3000 /* Default 60Hz frames per ROM */
+
+// Equivalence checks run by `make check`. Without CHIP8_CHECK_AOT every ROM runs on a batch of
+// lanes and, lane for lane, on CPUs of their own, once per engine. Built once per ROM with
+// CHIP8_CHECK_AOT naming the ROM's translation, it runs the translation against the cached engine.
+// Both feed the same pseudo-random key presses to either side and compare the whole machine state.
+// `--quirks` instead checks the quirk profiles, which have no second implementation to compare
+// against, with hand-written programs and known screens of the Timendus quirks test.
+#ifdef CHIP8_CHECK_AOT
+extern const Chip8_Aot CHIP8_CHECK_AOT;
+#endif
+
+// Hold one key about one frame in eight. The sequence only depends on `state`, so both sides see
+// the same presses
+static void chip8_check_keys(Chip8_CPU *cpu, uint32_t *state)
+{
+    *state = *state * 1103515245u + 12345u;
+    memset(cpu->chip8_key_state, 0, sizeof(cpu->chip8_key_state));
+    if ((*state >> 16) % 8 == 0) cpu->chip8_key_state[(*state >> 20) % CHIP8_FONT_COUNT] = true;
+}
+
+static uint64_t chip8_check_frame_cycles(uint64_t frame)
+{
+    return (uint64_t)((double)(frame + 1) * CHIP8_CPU_HZ / CHIP8_TIMER_HZ)
+         - (uint64_t)((double)frame * CHIP8_CPU_HZ / CHIP8_TIMER_HZ);
+}
+
+static bool chip8_check_same(const Chip8_CPU *a, const Chip8_CPU *b)
+{
+    return memcmp(a->chip8_vregs, b->chip8_vregs, sizeof(a->chip8_vregs)) == 0
+        && a->chip8_ir == b->chip8_ir
+        && a->chip8_pc == b->chip8_pc
+        && a->chip8_d_timer == b->chip8_d_timer
+        && a->chip8_s_timer == b->chip8_s_timer
+        && a->chip8_stack.count == b->chip8_stack.count
+        && memcmp(a->chip8_stack.slots, b->chip8_stack.slots, a->chip8_stack.count) == 0
+        && memcmp(a->chip8_memory, b->chip8_memory, sizeof(a->chip8_memory)) == 0
+        && memcmp(a->chip8_frame_buffer, b->chip8_frame_buffer, sizeof(a->chip8_frame_buffer)) == 0
+        && a->chip8_cycles == b->chip8_cycles
+        && a->chip8_draws == b->chip8_draws
+        && a->chip8_rng == b->chip8_rng;
+}
+
+static void chip8_check_report(const char *rom_path, const char *what, const Chip8_CPU *got, const Chip8_CPU *want)
+{
+    fprintf(stderr, "[ERROR] `%s`: %s differs, PC 0X%03X vs 0X%03X after %lu vs %lu cycles\n",
+            rom_path, what, got->chip8_pc, want->chip8_pc,
+            (unsigned long)got->chip8_cycles, (unsigned long)want->chip8_cycles);
+}
+
+#ifdef CHIP8_CHECK_AOT
+
+// Run the translation and the cached engine side by side, comparing after every frame
+static bool chip8_check_rom(const char *rom_path, uint64_t frames)
+{
+    static Chip8_CPU aot, cached;
+    chip8_reset(&cached);
+    if (!chip8_read_file_into_memory(&cached, rom_path)) return false;
+    aot = cached;
+    if (!chip8_aot_attach(&aot, &CHIP8_CHECK_AOT)) return false;
+
+    uint32_t keys = 1;
+    Chip8_Status aot_status = CHIP8_OK, cached_status = CHIP8_OK;
+    uint64_t f = 0;
+    for (; f < frames && cached_status == CHIP8_OK; ++f) {
+        chip8_check_keys(&cached, &keys);
+        memcpy(aot.chip8_key_state, cached.chip8_key_state, sizeof(aot.chip8_key_state));
+
+        uint64_t n = chip8_check_frame_cycles(f);
+        aot_status    = chip8_run_cycles(&aot, n);
+        cached_status = chip8_run_cycles(&cached, n);
+        if (aot_status != cached_status || !chip8_check_same(&aot, &cached)) {
+            char what[64];
+            snprintf(what, sizeof(what), "translation at frame %lu", (unsigned long)f);
+            chip8_check_report(rom_path, what, &aot, &cached);
+            return false;
+        }
+        chip8_tick_timers(&aot);
+        chip8_tick_timers(&cached);
+    }
+
+    printf("%-32s translation matches the %s engine for %lu frames (%s)\n", rom_path,
+           chip8_engine_name(CHIP8_ENGINE_CACHED), (unsigned long)f, chip8_status_name(cached_status));
+    return true;
+}
+
+#else
+
+// Run CHIP8_BATCH_LANES lanes, each seeded and pressing keys of its own, on the batch engine and
+// on separate CPUs. A lane stops at its first fault on either side
+static bool chip8_check_batch(const char *rom_path, uint64_t frames, Chip8_Engine engine, bool skip_idle)
+{
+    static Chip8_Batch batch;
+    static Chip8_CPU cpus[CHIP8_BATCH_LANES];
+    Chip8_Status status[CHIP8_BATCH_LANES];
+    uint32_t keys[CHIP8_BATCH_LANES];
+
+    for (int i = 0; i < CHIP8_BATCH_LANES; ++i) {
+        chip8_reset(&cpus[i]);
+        if (!chip8_read_file_into_memory(&cpus[i], rom_path)) return false;
+        chip8_seed_random(&cpus[i], (uint32_t)i + 1);
+        cpus[i].chip8_engine    = engine;
+        cpus[i].chip8_skip_idle = skip_idle;
+        batch.cpus[i] = cpus[i];
+        status[i] = CHIP8_OK;
+        keys[i]   = (uint32_t)i + 1;
+    }
+    if (!chip8_batch_begin(&batch, CHIP8_BATCH_LANES)) return false;
+
+    for (uint64_t f = 0; f < frames; ++f) {
+        for (int i = 0; i < CHIP8_BATCH_LANES; ++i) {
+            chip8_check_keys(&cpus[i], &keys[i]);
+            memcpy(batch.cpus[i].chip8_key_state, cpus[i].chip8_key_state, sizeof(cpus[i].chip8_key_state));
+        }
+
+        uint64_t n = chip8_check_frame_cycles(f);
+        chip8_batch_run(&batch, n);
+        chip8_batch_tick_timers(&batch);
+        for (int i = 0; i < CHIP8_BATCH_LANES; ++i) {
+            if (status[i] == CHIP8_OK) status[i] = chip8_run_cycles(&cpus[i], n);
+            chip8_tick_timers(&cpus[i]);
+        }
+    }
+
+    chip8_batch_sync(&batch);
+    for (int i = 0; i < CHIP8_BATCH_LANES; ++i) {
+        if (batch.status[i] != status[i] || !chip8_check_same(&batch.cpus[i], &cpus[i])) {
+            char what[64];
+            snprintf(what, sizeof(what), "batch lane %d on the %s engine%s", i, chip8_engine_name(engine),
+                     skip_idle ? "" : " without idle skipping");
+            chip8_check_report(rom_path, what, &batch.cpus[i], &cpus[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool chip8_check_rom(const char *rom_path, uint64_t frames)
+{
+    for (int e = 0; e < CHIP8_ENGINE_COUNT; ++e) {
+        if (!chip8_check_batch(rom_path, frames, (Chip8_Engine)e, true)) return false;
+        if (!chip8_check_batch(rom_path, frames, (Chip8_Engine)e, false)) return false;
+    }
+    printf("%-32s batch of %d lanes matches separate CPUs on every engine for %lu frames\n",
+           rom_path, CHIP8_BATCH_LANES, (unsigned long)frames);
+    return true;
+}
+
+#define CHIP8_CHECK_QUIRK_OPS       8     /* Longest program of a Chip8_Check_Quirk */
+#define CHIP8_CHECK_QUIRKS_FRAMES   600   /* Frames the Timendus quirks test runs for */
+#define CHIP8_CHECK_QUIRKS_PLATFORM 0x1FF /* The Timendus quirks test skips its menu if this is 1-3 */
+
+typedef enum Chip8_Check_Probe {
+    CHIP8_PROBE_V0 = 0,
+    CHIP8_PROBE_VF,
+    CHIP8_PROBE_I,
+    CHIP8_PROBE_PC,
+    CHIP8_PROBE_TOP_ROW,    // Frame buffer row 0
+    CHIP8_PROBE_BOTTOM_ROW, // Frame buffer row CHIP8_DH - 1
+} Chip8_Check_Probe;
+
+// A program of up to CHIP8_CHECK_QUIRK_OPS instructions, 0000 ending it early, and what `probe`
+// reads after running all of them under each profile
+typedef struct Chip8_Check_Quirk {
+    const char        *name;
+    uint16_t           ops[CHIP8_CHECK_QUIRK_OPS];
+    Chip8_Check_Probe  probe;
+    uint64_t           want[CHIP8_QUIRKS_COUNT]; // Indexed by profile, the LEGACY entry is unused
+} Chip8_Check_Quirk;
+
+#define CHIP8_CHECK_WANT(vip, chip48, schip, xochip) \
+    { [CHIP8_QUIRKS_VIP] = (vip), [CHIP8_QUIRKS_CHIP48] = (chip48), [CHIP8_QUIRKS_SCHIP] = (schip), [CHIP8_QUIRKS_XOCHIP] = (xochip) }
+
+static const Chip8_Check_Quirk chip8_check_quirks_cases[] = {
+    { "8XY1 resets VF",       { 0x6F05, 0x6003, 0x6105, 0x8011 },         CHIP8_PROBE_VF, CHIP8_CHECK_WANT(0, 5, 5, 5) },
+    { "8XY2 resets VF",       { 0x6F05, 0x6003, 0x6105, 0x8012 },         CHIP8_PROBE_VF, CHIP8_CHECK_WANT(0, 5, 5, 5) },
+    { "8XY3 resets VF",       { 0x6F05, 0x6003, 0x6105, 0x8013 },         CHIP8_PROBE_VF, CHIP8_CHECK_WANT(0, 5, 5, 5) },
+    { "8XY6 shifts",          { 0x6003, 0x6106, 0x8016 },                 CHIP8_PROBE_V0, CHIP8_CHECK_WANT(3, 1, 1, 3) },
+    { "8XY6 flag",            { 0x6003, 0x6106, 0x8016 },                 CHIP8_PROBE_VF, CHIP8_CHECK_WANT(0, 1, 1, 0) },
+    { "8XYE shifts",          { 0x6003, 0x6181, 0x801E },                 CHIP8_PROBE_V0, CHIP8_CHECK_WANT(2, 6, 6, 2) },
+    { "8XYE flag",            { 0x6003, 0x6181, 0x801E },                 CHIP8_PROBE_VF, CHIP8_CHECK_WANT(1, 0, 0, 1) },
+    { "FX55 leaves I",        { 0xA300, 0x6001, 0x6102, 0xF155 },         CHIP8_PROBE_I,  CHIP8_CHECK_WANT(0x302, 0x301, 0x300, 0x302) },
+    { "FX65 leaves I",        { 0xA300, 0xF165 },                         CHIP8_PROBE_I,  CHIP8_CHECK_WANT(0x302, 0x301, 0x300, 0x302) },
+    { "BNNN jumps",           { 0x6004, 0x6210, 0xB220 },                 CHIP8_PROBE_PC, CHIP8_CHECK_WANT(0x224, 0x230, 0x230, 0x224) },
+    { "DXYN at the right",    { 0xA000, 0x603E, 0x6100, 0xD011 },         CHIP8_PROBE_TOP_ROW,
+      CHIP8_CHECK_WANT(0x3, 0x3, 0x3, 0xC000000000000003) },
+    { "DXYN at the bottom",   { 0xA000, 0x6000, 0x611F, 0xD012 },         CHIP8_PROBE_TOP_ROW,
+      CHIP8_CHECK_WANT(0, 0, 0, 0x9000000000000000) },
+    { "DXYN start wraps",     { 0xA000, 0x6040, 0x615F, 0xD011 },         CHIP8_PROBE_BOTTOM_ROW,
+      CHIP8_CHECK_WANT(0xF000000000000000, 0xF000000000000000, 0xF000000000000000, 0xF000000000000000) },
+};
+
+// Final screen of the Timendus quirks test with CHIP-8 picked as its platform. Every profile is
+// checked against the CHIP-8 expectations, so each one shows its own marks
+typedef struct Chip8_Check_Quirks_Screen {
+    Chip8_Quirks quirks;
+    uint32_t     screen_hash;
+} Chip8_Check_Quirks_Screen;
+
+static const Chip8_Check_Quirks_Screen chip8_check_quirks_screens[] = {
+    { CHIP8_QUIRKS_VIP,    0x3e4a0f96 }, // Every row but DISP.WAIT passes, the display wait isn't modelled
+    { CHIP8_QUIRKS_CHIP48, 0x79ac99b3 },
+    { CHIP8_QUIRKS_SCHIP,  0xc0b8810a },
+    { CHIP8_QUIRKS_XOCHIP, 0x8871a4fa },
+};
+
+static uint64_t chip8_check_probe(const Chip8_CPU *cpu, Chip8_Check_Probe probe)
+{
+    switch (probe) {
+    case CHIP8_PROBE_V0:         return cpu->chip8_vregs[0];
+    case CHIP8_PROBE_VF:         return cpu->chip8_vregs[0XF];
+    case CHIP8_PROBE_I:          return cpu->chip8_ir;
+    case CHIP8_PROBE_PC:         return cpu->chip8_pc;
+    case CHIP8_PROBE_TOP_ROW:    return cpu->chip8_frame_buffer[0];
+    case CHIP8_PROBE_BOTTOM_ROW: return cpu->chip8_frame_buffer[CHIP8_DH - 1];
+    }
+    return 0;
+}
+
+static uint32_t chip8_check_screen_hash(const Chip8_CPU *cpu)
+{
+    uint32_t hash = 2166136261u;
+    for (int y = 0; y < CHIP8_DH; ++y) {
+        for (int i = 0; i < 8; ++i) {
+            hash ^= (cpu->chip8_frame_buffer[y] >> (8 * i)) & 0xFF;
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+static bool chip8_check_quirk_case(const Chip8_Check_Quirk *test, Chip8_Quirks quirks)
+{
+    static Chip8_CPU cpu;
+    uint8_t rom[2 * CHIP8_CHECK_QUIRK_OPS];
+    size_t count = 0;
+    while (count < CHIP8_CHECK_QUIRK_OPS && test->ops[count] != 0) {
+        rom[2 * count]     = (uint8_t)(test->ops[count] >> 8);
+        rom[2 * count + 1] = (uint8_t)test->ops[count];
+        count++;
+    }
+
+    chip8_reset(&cpu);
+    if (!chip8_load_rom(&cpu, rom, 2 * count)) return false;
+    cpu.chip8_quirks = quirks;
+    Chip8_Status status = chip8_run_cycles(&cpu, count);
+    uint64_t got = chip8_check_probe(&cpu, test->probe);
+    if (status != CHIP8_OK || got != test->want[quirks]) {
+        fprintf(stderr, "[ERROR] %s under %s: got 0X%lX (%s), want 0X%lX\n", test->name, chip8_quirks_name(quirks),
+                (unsigned long)got, chip8_status_name(status), (unsigned long)test->want[quirks]);
+        return false;
+    }
+    return true;
+}
+
+static bool chip8_check_quirks_screen(const char *rom_path, const Chip8_Check_Quirks_Screen *screen)
+{
+    static Chip8_CPU cpu;
+    chip8_reset(&cpu);
+    if (!chip8_read_file_into_memory(&cpu, rom_path)) return false;
+    cpu.chip8_quirks    = screen->quirks;
+    cpu.chip8_skip_idle = true;
+    cpu.chip8_memory[CHIP8_CHECK_QUIRKS_PLATFORM] = 1;
+
+    Chip8_Status status = CHIP8_OK;
+    for (uint64_t f = 0; f < CHIP8_CHECK_QUIRKS_FRAMES && status == CHIP8_OK; ++f) {
+        status = chip8_run_cycles(&cpu, chip8_check_frame_cycles(f));
+        chip8_tick_timers(&cpu);
+    }
+    uint32_t hash = chip8_check_screen_hash(&cpu);
+    if (status != CHIP8_OK || hash != screen->screen_hash) {
+        fprintf(stderr, "[ERROR] `%s` under %s: screen %08x (%s), want %08x\n", rom_path,
+                chip8_quirks_name(screen->quirks), hash, chip8_status_name(status), screen->screen_hash);
+        return false;
+    }
+    return true;
+}
+
+static bool chip8_check_quirks(const char *rom_path)
+{
+    size_t cases = sizeof(chip8_check_quirks_cases) / sizeof(chip8_check_quirks_cases[0]);
+    size_t screens = sizeof(chip8_check_quirks_screens) / sizeof(chip8_check_quirks_screens[0]);
+    bool ok = true;
+    for (size_t i = 0; i < cases; ++i) {
+        for (int q = CHIP8_QUIRKS_LEGACY + 1; q < CHIP8_QUIRKS_COUNT; ++q) {
+            if (!chip8_check_quirk_case(&chip8_check_quirks_cases[i], (Chip8_Quirks)q)) ok = false;
+        }
+    }
+    for (size_t i = 0; i < screens; ++i) {
+        if (!chip8_check_quirks_screen(rom_path, &chip8_check_quirks_screens[i])) ok = false;
+    }
+    if (ok) {
+        printf("%-32s %zu quirk cases and the test's screen match under every profile\n", rom_path, cases);
+    }
+    return ok;
+}
+
+#endif
+
+static bool chip8_check_parse_u64(const char *value, uint64_t *out)
+{
+    char *end = NULL;
+    errno = 0;
+    unsigned long long result = strtoull(value, &end, 10);
+    if (errno != 0 || end == value || *end != '\0' || value[0] == '-' || result == 0) {
+        fprintf(stderr, "[ERROR] Invalid frame count `%s`\n", value);
+        return false;
+    }
+    *out = (uint64_t)result;
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t frames = CHIP8_CHECK_FRAMES;
+    int first_rom = 1;
+#ifndef CHIP8_CHECK_AOT
+    if (argc == 3 && strcmp(argv[1], "--quirks") == 0) return chip8_check_quirks(argv[2]) ? 0 : 1;
+#endif
+    if (argc > 2 && strcmp(argv[1], "--frames") == 0) {
+        if (!chip8_check_parse_u64(argv[2], &frames)) return 1;
+        first_rom = 3;
+    }
+    if (first_rom >= argc) {
+        fprintf(stderr, "[Usage] %s [--frames <n>] <input_path>...\n", argv[0]);
+        fprintf(stderr, "    --frames <n>  60Hz frames to run every ROM for (default %d)\n", CHIP8_CHECK_FRAMES);
+#ifndef CHIP8_CHECK_AOT
+        fprintf(stderr, "       %s --quirks <5-quirks.ch8>\n", argv[0]);
+        fprintf(stderr, "    --quirks      Check the quirk profiles, then their screens of the Timendus quirks test\n");
+#endif
+        return 1;
+    }
+
+    bool ok = true;
+    for (int i = first_rom; i < argc; ++i) {
+        if (!chip8_check_rom(argv[i], frames)) ok = false;
+    }
+    return ok ? 0 : 1;
+}
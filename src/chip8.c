@@ -3,120 +3,12 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
-#include <assert.h>
 #include <errno.h>
-#include <time.h>
 
-#include <SDL2/SDL.h>
+#include "chip8.h"
 
-#define CHIP8_VREG_COUNT    16       /* V registers count */
-#define CHIP8_STACK_CAP     64       /* Stack capacity */
-#define CHIP8_DW            64       /* Display Width */
-#define CHIP8_DH            32       /* Display Height */
-#define CHIP8_RAM_CAP       (1024*4) /* 4096 Addressable Memory */
-#define CHIP8_PROGRAM_ENTRY 0x200    /* Program Entry Point */
-
-#define CHIP8_WINDOW_WIDTH  640*2    /* SDL Window Width */
-#define CHIP8_WINDOW_HEIGHT 320*2    /* SDL Window Height */
-
-#define CHIP8_PIXEL_WIDTH  (CHIP8_WINDOW_WIDTH/CHIP8_DW)  /* Pixel Width */
-#define CHIP8_PIXEL_HEIGHT (CHIP8_WINDOW_HEIGHT/CHIP8_DH) /* Pixel Height */
-
-#define CHIP8_FONT_HEIGHT 5 /* FONT HEIGHT - 5 bytes*/
-
-#define CHIP8_CPU_HZ   ((double)700.0) /* CPU Speed */
-#define CHIP8_TIMER_HZ ((double)60.0)  /* CPU TIMER */
-
-#define CHIP8_DEBUG_RENDER 0
 #define CHIP8_DEBUG_OPCODE 0
 
-#define CHIP8_SOUND_FREQUENCY 440
-#define CHIP8_SOUND_SAMPLES   44100
-#define CHIP8_SOUND_DURATION  1
-
-/* Low Volume - 1 Amplitude Produces Loud Beep Sound Harmful for ears */
-#define CHIP8_SOUND_AMPLITUDE (0.01)
-
-#define CHIP8_SDL_ERROR(error, ret)                                 \
-    do {                                                            \
-        fprintf(stderr, "[ERROR] %s: %s\n", error, SDL_GetError()); \
-        return ret;                                                 \
-    }                                                               \
-    while (0)
-
-typedef struct Chip8_Stack {
-    uint8_t *slots;
-    uint8_t count;
-    uint8_t capacity;
-} Chip8_Stack;
-
-typedef struct Chip8_Wave {
-    double *samples;
-    size_t count;
-    size_t capacity;
-} Chip8_Wave;
-
-typedef struct Chip8_Sound {
-    double      sample_rate;
-    double      frequency;
-    double      duration;
-    double      amplitude;
-    Chip8_Wave  wave;
-    bool        playing;
-    SDL_AudioDeviceID dev;
-} Chip8_Sound;
-
-typedef enum Chip8_Keys {
-    CHIP8_ZERO = 0x0,
-    CHIP8_ONE,
-    CHIP8_TWO,
-    CHIP8_THREE,
-    CHIP8_FOUR,
-    CHIP8_FIVE,
-    CHIP8_SIX,
-    CHIP8_SEVEN,
-    CHIP8_EIGHT,
-    CHIP8_NINE,
-    CHIP8_A = 0xA,
-    CHIP8_B = 0xB,
-    CHIP8_C = 0xC,
-    CHIP8_D = 0xD,
-    CHIP8_E = 0XE,
-    CHIP8_F = 0XF,
-
-    // Font Count
-    CHIP8_FONT_COUNT
-} Chip8_Keys;
-
-typedef struct Chip8_CPU {
-    uint8_t  chip8_vregs[CHIP8_VREG_COUNT];          // Registers V0 - V15
-    uint16_t chip8_ir;                               // Index register
-    uint16_t chip8_pc;                               // Program Counter
-
-    uint8_t  chip8_d_timer;                          // Delay Timer
-    uint8_t  chip8_s_timer;                          // Sound Timer
-
-    uint8_t  chip8_memory[CHIP8_RAM_CAP];            // Chip8 RAM
-    uint8_t  chip8_frame_buffer[CHIP8_DW][CHIP8_DH]; // Frame Buffer
-    bool     chip8_key_state[CHIP8_FONT_COUNT];      // ALL false
-
-    Chip8_Stack  chip8_stack;                        // 16-Byte Stack
-    Chip8_Sound  sound;                              // Beep Sound
-} Chip8_CPU;
-
-typedef struct Chip8_Color {
-    uint8_t r;
-    uint8_t g;
-    uint8_t b;
-    uint8_t a;
-} Chip8_Color;
-
-#define BLACK (Chip8_Color){0,   0,     0, 255}
-#define WHITE (Chip8_Color){255, 255, 255, 255}
-#define RED   (Chip8_Color){255, 0,     0, 255}
-#define GREEN (Chip8_Color){0,   255,   0, 255}
-#define BLUE  (Chip8_Color){0,   0,   255, 255}
-
 typedef struct Chip8_Font {
     uint8_t font[CHIP8_FONT_HEIGHT];
 } Chip8_Font;
@@ -140,78 +32,53 @@ const Chip8_Font chip8_fontset[CHIP8_FONT_COUNT] = {
     [CHIP8_F].font     = {0XF0, 0X80, 0XF0, 0X80, 0X80},
 };
 
-bool chip8_add_sample(Chip8_Wave *wave, double sample)
-{
-    if (wave->count >= wave->capacity) {
-        fprintf(stderr, "[ERROR] Wave Buffer Capped: cannot add more samples\n");
-        return false;
-    }
+static const char *chip8_status_names[CHIP8_STATUS_COUNT] = {
+    [CHIP8_OK]              = "OK",
+    [CHIP8_FINISHED]        = "Finished",
+    [CHIP8_UNKNOWN_OPCODE]  = "Unknown Opcode",
+    [CHIP8_STACK_OVERFLOW]  = "Stack Full",
+    [CHIP8_STACK_UNDERFLOW] = "Stack Empty",
+    [CHIP8_OUT_OF_BOUNDS]   = "Out of Bounds",
+};
 
-    wave->samples[wave->count++] = sample;
-    return true;
-}
+static const char *chip8_engine_names[CHIP8_ENGINE_COUNT] = {
+    [CHIP8_ENGINE_CACHED]   = "cached",
+    [CHIP8_ENGINE_SWITCH]   = "switch",
+    [CHIP8_ENGINE_THREADED] = "threaded",
+    [CHIP8_ENGINE_JIT]      = "jit",
+};
 
-void chip8_generate_sound_wave(Chip8_CPU *cpu)
+const char *chip8_status_name(Chip8_Status status)
 {
-    int num_samples = cpu->sound.sample_rate * cpu->sound.duration;
-    double period   = cpu->sound.sample_rate / cpu->sound.frequency;
-    for (int i = 0; i < num_samples; ++i) {
-        double y = (fmod(i, period) < period / 2) ? cpu->sound.amplitude: -cpu->sound.amplitude;
-        chip8_add_sample(&cpu->sound.wave, y);
-    }
+    if (status < CHIP8_STATUS_COUNT) return chip8_status_names[status];
+    return "Invalid Status";
 }
 
-// NOTE: Define an Audio callback Function to populate the buffer
-void chip8_audio_callback(void *UserData, uint8_t *stream, int len) {
-    Chip8_Sound *sound = (Chip8_Sound*)UserData; // Get Sound Object
-    Chip8_Wave  *waves = &sound->wave;           // Get  Wave Values
-    int sample_to_fill = len / sizeof(int16_t);
-
-    static int sample_index = 0;
-    int16_t *buffer = (int16_t*)stream;
-
-    for (int i = 0; i < sample_to_fill; ++i) {
-        if (sound->playing && (size_t)sample_index < waves->count) {
-            buffer[i] = (int16_t)(waves->samples[sample_index] * 32767);
-            sample_index++;
-        } else {
-            buffer[i] = 0;
-        }
-        sample_index %= waves->count;
-    }
+const char *chip8_engine_name(Chip8_Engine engine)
+{
+    if (engine < CHIP8_ENGINE_COUNT) return chip8_engine_names[engine];
+    return "invalid";
 }
 
-bool chip8_open_audio_device(Chip8_CPU *cpu)
+bool chip8_parse_engine(const char *name, Chip8_Engine *engine)
 {
-    SDL_AudioSpec want, have;
-
-    memset(&want, 0, sizeof(want));
-    want.freq = cpu->sound.sample_rate;
-    want.format = AUDIO_S16SYS;
-    want.channels = 1;
-    want.samples = 4096;
-    want.callback = chip8_audio_callback;
-    want.userdata = &cpu->sound;
-
-    cpu->sound.playing = false;
-
-    cpu->sound.dev = SDL_OpenAudioDevice(NULL, 0, &want, &have, SDL_AUDIO_ALLOW_FORMAT_CHANGE);
-    if (cpu->sound.dev == 0) {
-        CHIP8_SDL_ERROR("Failed to Open Audio Device", false);
+    for (int i = 0; i < CHIP8_ENGINE_COUNT; ++i) {
+        if (strcmp(name, chip8_engine_names[i]) == 0) {
+            *engine = (Chip8_Engine)i;
+            return true;
+        }
     }
-
-    SDL_PauseAudioDevice(cpu->sound.dev, 0);
-    return true;
+    return false;
 }
 
-uint8_t chip8_read_memory(const Chip8_CPU *cpu, const uint16_t loc)
+bool chip8_read_memory(const Chip8_CPU *cpu, const uint16_t loc, uint8_t *data)
 {
     // casting to int16_t because gcc will just wrap the negative values
     if ((int16_t)loc >= 0 && loc < CHIP8_RAM_CAP) {
-        return cpu->chip8_memory[loc];
+        *data = cpu->chip8_memory[loc];
+        return true;
     } else {
-        fprintf(stderr, "[PANIC] Index(%u) Out of Bounds for (%d)sized array\n", loc, CHIP8_RAM_CAP);
-        exit(EXIT_FAILURE);
+        return false;
     }
 }
 
@@ -220,69 +87,63 @@ bool chip8_write_memory(Chip8_CPU *cpu, const uint16_t loc, uint8_t data)
     // casting to int16_t because gcc will just wrap the negative values
     if ((int16_t)loc >= 0 && loc < CHIP8_RAM_CAP) {
         cpu->chip8_memory[loc] = data;
+        cpu->chip8_decoded[loc >> 1].handler = NULL; // Drop the cached decode of the instruction at loc & ~1
+        if (cpu->chip8_jit_pages & (1u << (loc >> 8))) chip8_jit_invalidate(cpu, loc);
+        if (cpu->chip8_write_map != NULL) cpu->chip8_write_map[loc >> 6] |= 1u << ((loc >> 1) & 31);
         return true;
     } else {
-        fprintf(stderr, "[PANIC] Index(%u) Out of Bounds for (%d)sized array\n", loc, CHIP8_RAM_CAP);
         return false;
     }
 }
 
-bool chip8_load_fontset(Chip8_CPU *cpu)
+void chip8_restore_memory(Chip8_CPU *cpu, const uint8_t *memory)
+{
+    // Compare a word at a time, going back to a nearby state usually changes a handful of bytes.
+    // Decode cache entries and JIT blocks of unchanged code survive
+    for (uint16_t i = 0; i < CHIP8_RAM_CAP; i += 8) {
+        uint64_t old_word, new_word;
+        memcpy(&old_word, &cpu->chip8_memory[i], 8);
+        memcpy(&new_word, &memory[i], 8);
+        if (old_word == new_word) continue;
+        for (uint16_t j = i; j < i + 8; ++j) {
+            if (cpu->chip8_memory[j] != memory[j]) chip8_write_memory(cpu, j, memory[j]);
+        }
+    }
+}
+
+static void chip8_load_fontset(Chip8_CPU *cpu)
 {
     for (uint8_t i = 0; i < CHIP8_FONT_COUNT; ++i) {
         for (uint8_t j = 0; j < CHIP8_FONT_HEIGHT; ++j) {
-            uint16_t index = i * CHIP8_FONT_HEIGHT + j;
-            if (!chip8_write_memory(cpu, index, chip8_fontset[i].font[j])) return false;
+            cpu->chip8_memory[i * CHIP8_FONT_HEIGHT + j] = chip8_fontset[i].font[j];
         }
     }
-
-#if CHIP8_DEBUG_RENDER
-    fprintf(stdout, "[INFO] Successfully Loaded the Fontset into Memory\n");
-#endif
-    return true;
 }
 
-// SDL Representation of 0 - F Keys
-const SDL_Keycode chip8_keys[CHIP8_FONT_COUNT] = {
-    [CHIP8_ZERO]  = SDLK_x,
-    [CHIP8_ONE]   = SDLK_1,
-    [CHIP8_TWO]   = SDLK_2,
-    [CHIP8_THREE] = SDLK_3,
-    [CHIP8_FOUR]  = SDLK_q,
-    [CHIP8_FIVE]  = SDLK_w,
-    [CHIP8_SIX]   = SDLK_e,
-    [CHIP8_SEVEN] = SDLK_a,
-    [CHIP8_EIGHT] = SDLK_s,
-    [CHIP8_NINE]  = SDLK_d,
-    [CHIP8_A]     = SDLK_z,
-    [CHIP8_B]     = SDLK_c,
-    [CHIP8_C]     = SDLK_4,
-    [CHIP8_D]     = SDLK_r,
-    [CHIP8_E]     = SDLK_f,
-    [CHIP8_F]     = SDLK_v,
-};
+#if CHIP8_DW != 64
+#error "The packed frame buffer stores one 64-pixel row per uint64_t"
+#endif
 
-uint8_t chip8_get_frame_buffer(Chip8_CPU *cpu, uint16_t x, uint16_t y)
+uint8_t chip8_get_frame_buffer(const Chip8_CPU *cpu, uint16_t x, uint16_t y)
 {
-    if (((int16_t)x >= 0 && x < CHIP8_DW) &&
-        ((int16_t)y >= 0 && y < CHIP8_DH))
-    {
-        return cpu->chip8_frame_buffer[x][y];
+    if (x < CHIP8_DW && y < CHIP8_DH) {
+        return (cpu->chip8_frame_buffer[y] >> (CHIP8_DW - 1 - x)) & 1;
     } else {
-        fprintf(stderr, "[PANIC] Index(%u, %u) Out of Bounds For (%d, %d) sized multi-array\n", x, y, CHIP8_DW, CHIP8_DH);
-        exit(EXIT_FAILURE);
+        return 0;
     }
 }
 
 bool chip8_set_frame_buffer(Chip8_CPU *cpu, uint16_t x, uint16_t y, uint8_t data)
 {
-    if (((int16_t)x >= 0 && x < CHIP8_DW) &&
-        ((int16_t)y >= 0 && y < CHIP8_DH))
-    {
-        cpu->chip8_frame_buffer[x][y] = data;
+    if (x < CHIP8_DW && y < CHIP8_DH) {
+        uint64_t bit = (uint64_t)1 << (CHIP8_DW - 1 - x);
+        if (data) {
+            cpu->chip8_frame_buffer[y] |= bit;
+        } else {
+            cpu->chip8_frame_buffer[y] &= ~bit;
+        }
         return true;
     } else {
-        fprintf(stderr, "[PANIC] Index(%u, %u) Out of Bounds For (%d, %d) sized multi-array\n", x, y, CHIP8_DW, CHIP8_DH);
         return false;
     }
 }
@@ -290,6 +151,7 @@ bool chip8_set_frame_buffer(Chip8_CPU *cpu, uint16_t x, uint16_t y, uint8_t data
 void chip8_clear_display(Chip8_CPU *cpu)
 {
     memset(cpu->chip8_frame_buffer, 0, sizeof(cpu->chip8_frame_buffer));
+    cpu->chip8_display_dirty = true;
 }
 
 static inline void chip8_split_uint16_t(uint16_t value, uint8_t *high, uint8_t *low)
@@ -303,12 +165,9 @@ static inline uint16_t chip8_bytes_to_uint16_t(uint8_t high, uint8_t low)
     return (high << 8) | low;
 }
 
-bool chip8_stack_push(Chip8_CPU *cpu, uint16_t value)
+static Chip8_Status chip8_stack_push(Chip8_CPU *cpu, uint16_t value)
 {
-    if (cpu->chip8_stack.count == cpu->chip8_stack.capacity) {
-        fprintf(stderr, "[ERROR] Stack Full\n");
-        return false;
-    }
+    if (cpu->chip8_stack.count + 2 > CHIP8_STACK_CAP) return CHIP8_STACK_OVERFLOW;
 
     uint8_t high = 0; // high
     uint8_t low  = 0; // low
@@ -316,68 +175,141 @@ bool chip8_stack_push(Chip8_CPU *cpu, uint16_t value)
     cpu->chip8_stack.slots[cpu->chip8_stack.count++] = high; // push high
     cpu->chip8_stack.slots[cpu->chip8_stack.count++] = low; // push low
 
-    return true;
+    return CHIP8_OK;
 }
 
-uint16_t chip8_stack_pop(Chip8_CPU *cpu)
+static Chip8_Status chip8_stack_pop(Chip8_CPU *cpu, uint16_t *value)
 {
-    if (cpu->chip8_stack.count < 2) {
-        fprintf(stderr, "[ERROR] Stack Empty\n");
-        exit(1);
-    }
+    if (cpu->chip8_stack.count < 2) return CHIP8_STACK_UNDERFLOW;
 
     uint8_t low  = cpu->chip8_stack.slots[--cpu->chip8_stack.count]; // Pop low
     uint8_t high = cpu->chip8_stack.slots[--cpu->chip8_stack.count]; // Pop high
 
-    return chip8_bytes_to_uint16_t(high, low);
+    *value = chip8_bytes_to_uint16_t(high, low);
+    return CHIP8_OK;
 }
 
-static inline uint8_t chip8_gen_random_byte()
+// xorshift32, the state lives in the CPU so copies and snapshots replay the same sequence
+static inline uint8_t chip8_gen_random_byte(Chip8_CPU *cpu)
 {
-    return (uint8_t)(rand() % (UINT8_MAX + 1));
+    uint32_t x = cpu->chip8_rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    cpu->chip8_rng = x;
+    return (uint8_t)(x >> 24);
 }
 
-void chip8_handle_input(Chip8_CPU *cpu, SDL_Event *event)
+void chip8_seed_random(Chip8_CPU *cpu, uint32_t seed)
 {
-    switch (event->type) {
-    case SDL_KEYDOWN: {
-        for (uint8_t i = 0; i < CHIP8_FONT_COUNT; ++i) {
-            if (event->key.keysym.sym == chip8_keys[i]) {
-                cpu->chip8_key_state[i] = true;
-                break;
-            }
-        }
-    } break;
+    cpu->chip8_rng = seed != 0 ? seed : CHIP8_RNG_SEED;
+}
 
-    case SDL_KEYUP: {
-        for (uint8_t i = 0; i < CHIP8_FONT_COUNT; ++i) {
-            if (event->key.keysym.sym == chip8_keys[i]) {
-                cpu->chip8_key_state[i] = false;
-                break;
-            }
+// Instruction helpers shared by the execution engines
+
+Chip8_Status chip8_op_call(Chip8_CPU *cpu, uint16_t nnn)
+{
+    Chip8_Status status = chip8_stack_push(cpu, cpu->chip8_pc); // Save  PC
+    if (status != CHIP8_OK) return status;
+    cpu->chip8_pc = nnn; // Call subroutine 2nnn, set pc to nnn
+    return CHIP8_OK;
+}
+
+Chip8_Status chip8_op_return(Chip8_CPU *cpu)
+{
+    // Pop PC from stack, return from subroutine
+    return chip8_stack_pop(cpu, &cpu->chip8_pc);
+}
+
+uint8_t chip8_op_random(Chip8_CPU *cpu, uint8_t kk)
+{
+    return chip8_gen_random_byte(cpu) & kk;
+}
+
+Chip8_Status chip8_op_draw(Chip8_CPU *cpu, uint8_t vidx_x, uint8_t vidx_y, uint8_t n_bytes)
+{
+    uint8_t x = cpu->chip8_vregs[vidx_x];
+    uint8_t y = cpu->chip8_vregs[vidx_y];
+
+    cpu->chip8_draws++;
+    cpu->chip8_display_dirty = true;
+    cpu->chip8_vregs[0XF] = 0; // Reset V[0XF]
+    unsigned shift = x % CHIP8_DW;
+    for (uint8_t i = 0; i < n_bytes; ++i) {
+        uint8_t sprite_byte = 0;
+        if (!chip8_read_memory(cpu, cpu->chip8_ir +i, &sprite_byte)) return CHIP8_OUT_OF_BOUNDS;
+
+        // Line the sprite byte up with column x, the rotate wraps it around the right edge
+        uint64_t sprite = (uint64_t)sprite_byte << (CHIP8_DW - 8);
+        if (shift) sprite = (sprite >> shift) | (sprite << (CHIP8_DW - shift));
+
+        uint64_t *row = &cpu->chip8_frame_buffer[(y + i) % CHIP8_DH];
+        if (*row & sprite) {
+            cpu->chip8_vregs[0XF] = 1; // Collision
         }
-    } break;
+        *row ^= sprite; // Xor the sprite onto the screen
+    }
+    return CHIP8_OK;
+}
 
-    default: {
-        fprintf(stderr, "[PANIC] Unreachable SDL_Type");
-        exit(EXIT_FAILURE);
+void chip8_op_wait_key(Chip8_CPU *cpu, uint8_t v_index)
+{
+    // put keycode in V[x]
+    for (uint8_t i = 0; i < CHIP8_FONT_COUNT; ++i) {
+        if (cpu->chip8_key_state[i]) {
+            cpu->chip8_vregs[v_index] = i;
+            return;
+        }
     }
+
+#if CHIP8_DEBUG_OPCODE
+    printf("Waiting For Key Press\n");
+#endif
+    cpu->chip8_pc -=2; // Wait for key press
+}
+
+Chip8_Status chip8_op_bcd(Chip8_CPU *cpu, uint8_t v_index)
+{
+    // Store BCD representation in I, I+1, I+2
+    uint8_t value = cpu->chip8_vregs[v_index];
+    uint8_t hunds = (value / 100);     // Hundreds
+    uint8_t tens  = (value / 10) % 10; // Tens
+    uint8_t ones  = (value % 10);      // Ones
+
+    if (!chip8_write_memory(cpu, cpu->chip8_ir, hunds))    return CHIP8_OUT_OF_BOUNDS;
+    if (!chip8_write_memory(cpu, cpu->chip8_ir + 1, tens)) return CHIP8_OUT_OF_BOUNDS;
+    if (!chip8_write_memory(cpu, cpu->chip8_ir + 2, ones)) return CHIP8_OUT_OF_BOUNDS;
+    return CHIP8_OK;
+}
+
+Chip8_Status chip8_op_store(Chip8_CPU *cpu, uint8_t v_index)
+{
+    for (uint8_t i = 0; i <= v_index; ++i) {
+        if (!chip8_write_memory(cpu, cpu->chip8_ir + (uint16_t)i, cpu->chip8_vregs[i])) return CHIP8_OUT_OF_BOUNDS;
     }
+    cpu->chip8_ir = cpu->chip8_ir + v_index + 1;
+    return CHIP8_OK;
 }
 
-bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
+Chip8_Status chip8_op_load(Chip8_CPU *cpu, uint8_t v_index)
 {
-    if (cpu->chip8_pc >= start+size) {
-        printf("Finished\n");
-        return false;
+    for (uint8_t i = 0; i <= v_index; ++i) {
+        if (!chip8_read_memory(cpu, cpu->chip8_ir + (uint16_t)i, &cpu->chip8_vregs[i])) return CHIP8_OUT_OF_BOUNDS;
     }
+    cpu->chip8_ir = cpu->chip8_ir + v_index + 1;
+    return CHIP8_OK;
+}
 
-#if CHIP8_TRACE
-    printf("PC at 0X%X\n", cpu->chip8_pc);
-#endif
+Chip8_Status chip8_execute_opcode(Chip8_CPU *cpu)
+{
+    if (cpu->chip8_pc >= CHIP8_PROGRAM_ENTRY + cpu->chip8_rom_size) {
+        return CHIP8_FINISHED;
+    }
 
-    uint8_t  high   = chip8_read_memory(cpu, cpu->chip8_pc);
-    uint8_t  low    = chip8_read_memory(cpu, cpu->chip8_pc+1);
+    uint8_t high = 0;
+    uint8_t low  = 0;
+    if (!chip8_read_memory(cpu, cpu->chip8_pc, &high))  return CHIP8_OUT_OF_BOUNDS;
+    if (!chip8_read_memory(cpu, cpu->chip8_pc+1, &low)) return CHIP8_OUT_OF_BOUNDS;
     uint16_t opcode = chip8_bytes_to_uint16_t(high, low);
 
     cpu->chip8_pc += 2;
@@ -389,27 +321,25 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
 #if CHIP8_DEBUG_OPCODE
             printf("00EE, Clear display: 0X%X\n", opcode);
 #endif
-            return true;
+            return CHIP8_OK;
         }
 
         case 0XEE: {  // 0X00EE
-            // Pop PC from stack, return from subroutine
-            cpu->chip8_pc = chip8_stack_pop(cpu);
 #if CHIP8_DEBUG_OPCODE
             printf("00E0, Return: 0X%X\n", opcode);
 #endif
-            return true;
+            return chip8_op_return(cpu);
         }
 
         default:
 #if CHIP8_DEBUG_OPCODE
             fprintf(stderr, "[ERROR] Unknown Last Byte `0X%X` For Opcode 0X%X\n", (opcode & 0XFF), opcode);
 #endif
-            return false;
+            return CHIP8_UNKNOWN_OPCODE;
         }
 
         fprintf(stderr, "[PANIC] Unreachable\n");
-        return false;
+        return CHIP8_UNKNOWN_OPCODE;
     }
 
     case 0X1: {
@@ -417,16 +347,14 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
         printf("1NNN, JMP to opcode: 0X%X\n", opcode);
 #endif
         cpu->chip8_pc = opcode & 0X0FFF; // JMP instruction 1nnn, set pc to nnn
-        return true;
+        return CHIP8_OK;
     }
 
     case 0X2: {
 #if CHIP8_DEBUG_OPCODE
         printf("2NNN, CALL: 0X%X\n", opcode);
 #endif
-        if (!chip8_stack_push(cpu, cpu->chip8_pc)) return false; // Save  PC
-        cpu->chip8_pc = opcode & 0X0FFF; // Call subroutine 2nnn, set pc to nnn
-        return true;
+        return chip8_op_call(cpu, opcode & 0X0FFF);
     }
 
     case 0x3: {
@@ -443,7 +371,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
         } else {
             ;
         }
-        return true;
+        return CHIP8_OK;
     }
 
     case 0X4: {
@@ -460,7 +388,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
         } else {
             ;
         }
-        return true;
+        return CHIP8_OK;
     }
 
     case 0X6: {
@@ -473,7 +401,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
         uint8_t low_byte = opcode & 0XFF;
 
         cpu->chip8_vregs[v_index] = low_byte;
-        return true;
+        return CHIP8_OK;
     }
 
     case 0X7: {
@@ -485,7 +413,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
         uint8_t low_byte = opcode & 0XFF;
 
         cpu->chip8_vregs[v_index] += low_byte; // Add Vx + byte, store it back to Vx
-        return true;
+        return CHIP8_OK;
     }
 
     case 0X8: {
@@ -500,7 +428,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
             printf("8xy0, LD Vx, Vy: 0X%X\n", opcode);
 #endif
             cpu->chip8_vregs[vidx_x] = cpu->chip8_vregs[vidx_y];
-            return true;
+            return CHIP8_OK;
         }
 
         case 0x1: {
@@ -508,7 +436,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
             printf("8xy1, OR Vx, Vy: 0X%X\n", opcode);
 #endif
             cpu->chip8_vregs[vidx_x] = cpu->chip8_vregs[vidx_x] | cpu->chip8_vregs[vidx_y];
-            return true;
+            return CHIP8_OK;
         }
 
         case 0x2: {
@@ -516,7 +444,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
             printf("8xy2, AND Vx, Vy: 0X%X\n", opcode);
 #endif
             cpu->chip8_vregs[vidx_x] = cpu->chip8_vregs[vidx_x] & cpu->chip8_vregs[vidx_y];
-            return true;
+            return CHIP8_OK;
         }
 
         case 0x3: {
@@ -524,7 +452,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
             printf("8xy3, XOR Vx, Vy: 0X%X\n", opcode);
 #endif
             cpu->chip8_vregs[vidx_x] = cpu->chip8_vregs[vidx_x] ^ cpu->chip8_vregs[vidx_y];
-            return true;
+            return CHIP8_OK;
         }
 
         case 0x4: {
@@ -541,7 +469,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
                 cpu->chip8_vregs[0XF] = 0;
             }
             cpu->chip8_vregs[vidx_x] = low;
-            return true;
+            return CHIP8_OK;
         }
 
         case 0x5: {
@@ -554,7 +482,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
                 cpu->chip8_vregs[0XF] = 0;
             }
             cpu->chip8_vregs[vidx_x] -= cpu->chip8_vregs[vidx_y];
-            return true;
+            return CHIP8_OK;
         }
 
         case 0x6: {
@@ -563,7 +491,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
 #endif
             cpu->chip8_vregs[0XF] = cpu->chip8_vregs[vidx_x] & 0x01; // set
             cpu->chip8_vregs[vidx_x] >>= 1;
-            return true;
+            return CHIP8_OK;
         }
 
         case 0x7: {
@@ -577,7 +505,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
             }
 
             cpu->chip8_vregs[vidx_x] = cpu->chip8_vregs[vidx_y] - cpu->chip8_vregs[vidx_x];
-            return true;
+            return CHIP8_OK;
         }
 
         case 0xE: {
@@ -590,18 +518,18 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
                 cpu->chip8_vregs[0XF] = 0; // else not set
             }
             cpu->chip8_vregs[vidx_x] <<= 1;
-            return true;
+            return CHIP8_OK;
         }
 
         default:
 #if CHIP8_DEBUG_OPCODE
             fprintf(stderr, "[ERROR]: Unknown last nibble `0X%X` for Opcode: 0X%X\n", l_nibble, opcode);
 #endif
-            return false;
+            return CHIP8_UNKNOWN_OPCODE;
         }
 
         fprintf(stderr, "[PANIC] Unreachable\n");
-        return false;
+        return CHIP8_UNKNOWN_OPCODE;
     }
 
     case 0x9: {
@@ -613,7 +541,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
         } else {
             ;
         }
-        return true;
+        return CHIP8_OK;
     }
 
     case 0XA: {
@@ -622,7 +550,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
         printf("ANNN, LD I, addr: 0X%X\n", opcode);
 #endif
         cpu->chip8_ir = opcode & 0X0FFF; // load the nnn to ir
-        return true;
+        return CHIP8_OK;
     }
 
     case 0XC: {
@@ -634,10 +562,9 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
 #endif
         uint8_t v_index  = ((opcode >> 8) & 0XF);
         uint8_t low_byte =  (opcode & 0XFF);
-        uint8_t random   = chip8_gen_random_byte();
 
-        cpu->chip8_vregs[v_index] = random & low_byte;
-        return true;
+        cpu->chip8_vregs[v_index] = chip8_op_random(cpu, low_byte);
+        return CHIP8_OK;
     }
 
     case 0XD: {
@@ -649,29 +576,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
         uint8_t vidx_x  = ((opcode >> 8) & 0XF);
         uint8_t vidx_y  = ((opcode >> 4) & 0XF);
         uint8_t n_bytes = (opcode & 0XF);
-        uint8_t x       = cpu->chip8_vregs[vidx_x];
-        uint8_t y       = cpu->chip8_vregs[vidx_y];
-
-        cpu->chip8_vregs[0XF] = 0; // Reset V[0XF]
-        for (uint8_t i = 0; i < n_bytes; ++i) {
-            uint8_t sprite_byte = chip8_read_memory(cpu, cpu->chip8_ir +i);
-            for (uint8_t j = 0; j < 8; ++j) {
-                if ((sprite_byte & (0x80 >> j))) {
-                    uint8_t pixel_x = (x + j) % CHIP8_DW;
-                    uint8_t pixel_y = (y + i) % CHIP8_DH;
-
-                    uint8_t current = chip8_get_frame_buffer(cpu, pixel_x, pixel_y);
-
-                    if (current) {
-                        cpu->chip8_vregs[0XF] = 1; // Collision
-                    }
-
-                    // Xor the current pixel on screen
-                    if (!chip8_set_frame_buffer(cpu, pixel_x, pixel_y, current ^ 1)) return false;
-                }
-            }
-        }
-        return true;
+        return chip8_op_draw(cpu, vidx_x, vidx_y, n_bytes);
     }
 
     case 0XE: {
@@ -679,14 +584,14 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
         printf("Ex9E - SKP Vx\n");
 #endif
         uint8_t v_index  = ((opcode >> 8) & 0XF);
-        uint8_t key = cpu->chip8_vregs[v_index];
+        uint8_t key = cpu->chip8_vregs[v_index] & 0XF;
         if (cpu->chip8_key_state[key]) {
             cpu->chip8_pc += 2;
         } else {
             ;
         }
 
-        return true;
+        return CHIP8_OK;
     }
 
     case 0XF: {
@@ -699,30 +604,15 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
             printf("FX1E, ADD I, Vx: 0X%X\n", opcode);
 #endif
             cpu->chip8_ir += cpu->chip8_vregs[v_index]; // Add V[x] to ir
-            return true;
+            return CHIP8_OK;
         }
 
         case 0X0A: {
 #if CHIP8_DEBUG_OPCODE
             printf("Fx0A, LD Vx, K: 0X%X\n", opcode);
 #endif
-            // put keycode in V[x]
-            bool pressed = false;
-            for (uint8_t i = 0; i < CHIP8_FONT_COUNT; ++i) {
-                if (cpu->chip8_key_state[i]) {
-                    cpu->chip8_vregs[v_index] = i;
-                    pressed = true;
-                    break;
-                }
-            }
-
-            if (!pressed) {
-#if CHIP8_DEBUG_OPCODE
-                printf("Waiting For Key Press\n");
-#endif
-                cpu->chip8_pc -=2; // Wait for key press
-            }
-            return true;
+            chip8_op_wait_key(cpu, v_index);
+            return CHIP8_OK;
         }
 
         case 0x07: {
@@ -730,7 +620,7 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
             printf("Fx07 - LD Vx, DT\n");
 #endif
             cpu->chip8_vregs[v_index] = cpu->chip8_d_timer;
-            return true;
+            return CHIP8_OK;
         }
 
         case 0x15: {
@@ -738,14 +628,14 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
             printf("Fx15 - LD DT, Vx\n");
 #endif
             cpu->chip8_d_timer = cpu->chip8_vregs[v_index];
-            return true;
+            return CHIP8_OK;
         }
         case 0x18: {
 #if CHIP8_DEBUG_OPCODE
             printf("Fx18 - LD ST, Vx\n");
 #endif
             cpu->chip8_s_timer = cpu->chip8_vregs[v_index];
-            return true;
+            return CHIP8_OK;
         }
 
         case 0X29: {
@@ -753,177 +643,210 @@ bool chip8_execute_opcode(Chip8_CPU *cpu, uint16_t start, uint16_t size)
             printf("Fx29, LD F, Vx: 0X%X\n", opcode);
 #endif
             cpu->chip8_ir = cpu->chip8_vregs[v_index];
-            return true;
+            return CHIP8_OK;
         }
 
         case 0X33: {
-            // Store BCD representation in I, I+1, I+2
 #if CHIP8_DEBUG_OPCODE
             printf("Fx33 - LD B, Vx\n");
 #endif
-            uint8_t value = cpu->chip8_vregs[v_index];
-            uint8_t hunds = (value / 100);     // Hundreds
-            uint8_t tens  = (value / 10) % 10; // Tens
-            uint8_t ones  = (value % 10);      // Ones
-
-            if (!chip8_write_memory(cpu, cpu->chip8_ir, hunds))    return false;
-            if (!chip8_write_memory(cpu, cpu->chip8_ir + 1, tens)) return false;
-            if (!chip8_write_memory(cpu, cpu->chip8_ir + 2, ones)) return false;
-            return true;
+            return chip8_op_bcd(cpu, v_index);
         }
 
         case 0x55: {
 #if CHIP8_DEBUG_OPCODE
             printf("Fx55 - LD [I], Vx\n");
 #endif
-            for (uint8_t i = 0; i <= v_index; ++i) {
-                if (!chip8_write_memory(cpu, cpu->chip8_ir + (uint16_t)i, cpu->chip8_vregs[i])) return false;
-            }
-            cpu->chip8_ir = cpu->chip8_ir + v_index + 1;
-            return true;
+            return chip8_op_store(cpu, v_index);
         }
 
         case 0x65: {
 #if CHIP8_DEBUG_OPCODE
             printf("Fx65 - LD Vx, [I]\n");
 #endif
-            for (uint8_t i = 0; i <= v_index; ++i) {
-                cpu->chip8_vregs[i] = chip8_read_memory(cpu, cpu->chip8_ir + (uint16_t)i);
-            }
-            cpu->chip8_ir = cpu->chip8_ir + v_index + 1;
-            return true;
+            return chip8_op_load(cpu, v_index);
         }
 
         default:
 #if CHIP8_DEBUG_OPCODE
             fprintf(stderr, "[ERROR]: Unknown low_byte `0X%X` for Opcode: 0X%X\n", low_byte, opcode);
 #endif
-            return false;
+            return CHIP8_UNKNOWN_OPCODE;
         }
         // UNREACHABLE
         fprintf(stderr, "[PANIC] Unreachable\n");
-        return false;
+        return CHIP8_UNKNOWN_OPCODE;
     }
 
     default:
 #if CHIP8_DEBUG_OPCODE
         fprintf(stderr, "[ERROR]: Unknown opcode: 0X%X\n", opcode);
 #endif
-        return false;
+        return CHIP8_UNKNOWN_OPCODE;
     }
     // UNREACHABLE
     fprintf(stderr, "[PANIC] Unreachable\n");
-    return false;
+    return CHIP8_UNKNOWN_OPCODE;
 }
 
-bool chip8_read_file_into_memory(Chip8_CPU *cpu, const char *chip8_file_path, size_t *chip8_file_size)
+static inline uint16_t chip8_opcode_at(const Chip8_CPU *cpu, uint16_t loc)
 {
-    FILE *fp = fopen(chip8_file_path, "rb");
-    if (fp == NULL) {
-        fprintf(stderr, "[ERROR] Could not read `%s`: `%s`\n", chip8_file_path, strerror(errno));
-        return false;
-    }
+    return chip8_bytes_to_uint16_t(cpu->chip8_memory[loc], cpu->chip8_memory[loc + 1]);
+}
 
-    int ret = fseek(fp, 0, SEEK_END);
-    if (ret < 0) {
-        fprintf(stderr, "[ERROR] Could not seek to end of `%s`: `%s`\n", chip8_file_path, strerror(errno));
-        return false;
+// Length in instructions of the idle loop PC sits in, 0 when it isn't in one.
+// An idle loop repeats with the same state until a timer tick or a key changes:
+//   1NNN jumping to itself
+//   FX0A with no key held
+//   EX9E or EXA1 / 1NNN back to it, with key Vx up
+//   FX07 / 3XKK or 4XKK / 1NNN back to the FX07, while the skip isn't taken for DT
+// A delay timer poll is only `settled` once Vx holds DT, until then one more pass may leave the loop.
+// `*start` is set to the address of the loop's first instruction
+static uint16_t chip8_idle_loop_find(const Chip8_CPU *cpu, bool *settled, uint16_t *start_out)
+{
+    *settled = true;
+    uint16_t pc = cpu->chip8_pc;
+    *start_out = pc;
+    if ((pc & 1) || pc + 6 > CHIP8_RAM_CAP) return 0;
+
+    uint16_t opcode = chip8_opcode_at(cpu, pc);
+    if (opcode == (0x1000 | pc)) return 1;
+    if ((opcode & 0xF0FF) == 0xF00A) {
+        for (uint8_t i = 0; i < CHIP8_FONT_COUNT; ++i) {
+            if (cpu->chip8_key_state[i]) return 0;
+        }
+        return 1;
     }
 
-    size_t size = ftell(fp);
-    if (size <= 0) {
-        fprintf(stderr, "[ERROR] File `%s` Empty\n", chip8_file_path);
-        return false;
-    }
+    // PC may be on any instruction of a two or three instruction poll
+    for (uint16_t back = 0; back <= 4 && back <= pc; back += 2) {
+        uint16_t start = pc - back;
+        uint16_t first = chip8_opcode_at(cpu, start);
+        uint8_t  x     = (first >> 8) & 0xF;
+        *start_out = start;
 
-    size_t max_size = CHIP8_RAM_CAP - CHIP8_PROGRAM_ENTRY;
-    if (size > max_size) {
-        fprintf(stderr, "[ERROR] Cannot Fit %zu bytes: MEMORY CAPACITY: %zu\n", size, max_size);
-        return false;
-    }
+        // Every EX?? executes as SKP, except under the quirk profiles where EXA1 skips while the key is up
+        if ((first & 0xF000) == 0xE000 && back <= 2 && chip8_opcode_at(cpu, start + 2) == (0x1000 | start)) {
+            uint8_t key = cpu->chip8_vregs[x] & 0xF;
+            bool skp = cpu->chip8_quirks == CHIP8_QUIRKS_LEGACY || (first & 0xFF) == 0x9E;
+            if (skp) return !cpu->chip8_key_state[key] ? 2 : 0;
+            if ((first & 0xFF) == 0xA1) return cpu->chip8_key_state[key] ? 2 : 0;
+            return 0;
+        }
 
-    rewind(fp); // Rewind the file pointer to the beginning
+        uint16_t skip = chip8_opcode_at(cpu, start + 2);
+        if ((first & 0xF0FF) != 0xF007 || chip8_opcode_at(cpu, start + 4) != (0x1000 | start)) continue;
+        if ((skip & 0xF000) != 0x3000 && (skip & 0xF000) != 0x4000) continue;
+        if ((skip & 0x0F00) != (first & 0x0F00)) continue;
 
-    // Read the chip8 rom directly into the chip8 memory
-    size_t bytes = fread(&cpu->chip8_memory[CHIP8_PROGRAM_ENTRY], sizeof(uint8_t), size, fp);
-    if (bytes != (size_t)size) {
-        fprintf(stderr, "fread() failed: Expected %ld bytes got %zu bytes\n", size, bytes);
-        return false;
+        bool equal = cpu->chip8_d_timer == (skip & 0xFF);
+        bool taken = (skip & 0xF000) == 0x3000 ? equal : !equal;
+        *settled = cpu->chip8_vregs[x] == cpu->chip8_d_timer;
+        return taken ? 0 : 3;
     }
+    return 0;
+}
 
-    *chip8_file_size = size;
-    fclose(fp); // close file pointer
-    return true;
+// A loop reaching past the end of the program isn't skipped: running it stops with CHIP8_FINISHED
+static uint16_t chip8_idle_loop_length(const Chip8_CPU *cpu, bool *settled)
+{
+    uint16_t start = 0;
+    uint16_t length = chip8_idle_loop_find(cpu, settled, &start);
+    if (start + 2 * length > CHIP8_PROGRAM_ENTRY + cpu->chip8_rom_size) return 0;
+    return length;
 }
 
-bool chip8_draw_pixel(SDL_Renderer *renderer, int x, int y, int w, int h, const Chip8_Color color)
+static Chip8_Status chip8_run_engine(Chip8_CPU *cpu, uint64_t n)
 {
-    const SDL_Rect pixel = {x , y , w , h};
+    if (cpu->chip8_profile != NULL || cpu->chip8_tracer != NULL) return chip8_run_instrumented(cpu, n);
+    if (cpu->chip8_quirks != CHIP8_QUIRKS_LEGACY) return chip8_run_quirks(cpu, n);
+    if (cpu->chip8_aot != NULL) return cpu->chip8_aot->run(cpu, n);
 
-    int ret;
-    ret = SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND); // Set blend mode
-    if (ret != 0) {
-        CHIP8_SDL_ERROR("SDL_SetRenderDrawBlendMode", false);
+    switch (cpu->chip8_engine) {
+    case CHIP8_ENGINE_CACHED: {
+        for (uint64_t i = 0; i < n; ++i) {
+            Chip8_Status status = chip8_execute_cached(cpu);
+            if (status != CHIP8_OK) return status;
+            cpu->chip8_cycles++;
+        }
+        return CHIP8_OK;
     }
 
-    ret = SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a); // Set Pixel Color
-    if (ret != 0) {
-        CHIP8_SDL_ERROR("SDL_SetRenderDrawColor", false);
-    }
+    case CHIP8_ENGINE_THREADED:
+        return chip8_run_threaded(cpu, n);
+
+    case CHIP8_ENGINE_JIT:
+        return chip8_run_jit(cpu, n);
 
-    ret = SDL_RenderFillRect(renderer, &pixel);
-    if (ret != 0) {
-        CHIP8_SDL_ERROR("SDL_RenderFillRect", false);
+    case CHIP8_ENGINE_SWITCH:
+    default: {
+        for (uint64_t i = 0; i < n; ++i) {
+            Chip8_Status status = chip8_execute_opcode(cpu);
+            if (status != CHIP8_OK) return status;
+            cpu->chip8_cycles++;
+        }
+        return CHIP8_OK;
     }
+    }
+}
 
-#if CHIP8_DEBUG_RENDER
-    fprintf(stdout, "[INFO] Pixel Size(%d, %d) Rendered at Position(%d, %d)\n", w , h, x, y);
-#endif
-    return true;
+Chip8_Status chip8_run_cycles(Chip8_CPU *cpu, uint64_t n)
+{
+    cpu->chip8_idle = false;
+    if (cpu->chip8_skip_idle && n > 0) {
+        bool settled = true;
+        uint16_t length = chip8_idle_loop_length(cpu, &settled);
+        if (length > 0 && !settled) {
+            // Vx still holds DT from before the last tick, one pass through the loop reloads it
+            uint64_t first = n < length ? n : length;
+            Chip8_Status status = chip8_run_engine(cpu, first);
+            if (status != CHIP8_OK) return status;
+            n -= first;
+            length = n > 0 ? chip8_idle_loop_length(cpu, &settled) : 0;
+        }
+        if (length > 0 && settled) {
+            // Whole passes through the loop leave the state as it is, count them without running them
+            uint64_t skipped = n - n % length;
+            cpu->chip8_cycles += skipped;
+            cpu->chip8_idle    = true;
+            n -= skipped;
+            if (cpu->chip8_profile != NULL) cpu->chip8_profile->idle_cycles += skipped;
+        }
+    }
+    return chip8_run_engine(cpu, n);
 }
 
-bool chip8_clear_background(SDL_Renderer *renderer, const Chip8_Color color)
+bool chip8_aot_attach(Chip8_CPU *cpu, const Chip8_Aot *aot)
 {
-    int ret;
-    ret = SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a); // Set Background Color
-    if (ret != 0) {
-        CHIP8_SDL_ERROR("SDL_SetRenderDrawColor", false);
+    if (aot != NULL && (aot->rom_size != cpu->chip8_rom_size || aot->rom_hash != cpu->chip8_rom_hash)) {
+        fprintf(stderr, "[ERROR] Translation was made from a different program\n");
+        return false;
     }
-
-    ret = SDL_RenderClear(renderer); // Clear Background with Set Color
-    if (ret != 0) {
-        CHIP8_SDL_ERROR("SDL_RenderClear", false);
+    if (aot != NULL && cpu->chip8_quirks != CHIP8_QUIRKS_LEGACY) {
+        fprintf(stderr, "[ERROR] Translations only run the legacy instruction set\n");
+        return false;
     }
+    cpu->chip8_aot = aot;
     return true;
 }
 
-bool chip8_render_pixels(Chip8_CPU *cpu, SDL_Renderer *renderer, const Chip8_Color color)
+bool chip8_in_idle_loop(const Chip8_CPU *cpu)
 {
-    for (int j = 0; j < CHIP8_DH; ++j) {
-        for (int i = 0; i < CHIP8_DW; ++i) {
-            if (chip8_get_frame_buffer(cpu, i, j)) {
-                int x = i*CHIP8_PIXEL_WIDTH;
-                int y = j*CHIP8_PIXEL_HEIGHT;
-                if (chip8_draw_pixel(renderer, x, y, CHIP8_PIXEL_WIDTH, CHIP8_PIXEL_HEIGHT, color)) {
-                    ;
-                } else {
-                    return false;
-                }
-            }
-        }
-    }
-    return true;
+    bool settled = true;
+    return chip8_idle_loop_length(cpu, &settled) > 0;
 }
 
-const char *chip8_shift_args(int *argc, char ***argv)
+bool chip8_tick_timers(Chip8_CPU *cpu)
 {
-    const char *result = **argv;
-    (*argc)--;
-    (*argv)++;
-    return result;
+    if (cpu->chip8_d_timer > 0) cpu->chip8_d_timer--;
+    if (cpu->chip8_s_timer > 0) {
+        cpu->chip8_s_timer--;
+        return true;
+    }
+    return false;
 }
 
-bool chip8_initialize_states(Chip8_CPU *cpu, const char *chip8_rom_path, size_t *size)
+void chip8_reset(Chip8_CPU *cpu)
 {
     // Memset The Chip8 cpu structure
     memset(cpu, 0, sizeof(Chip8_CPU));
@@ -931,146 +854,94 @@ bool chip8_initialize_states(Chip8_CPU *cpu, const char *chip8_rom_path, size_t
     cpu->chip8_d_timer = CHIP8_TIMER_HZ;
     cpu->chip8_s_timer = CHIP8_TIMER_HZ;
 
-    // Initialize Stack
-    cpu->chip8_stack.capacity = CHIP8_STACK_CAP;
-    cpu->chip8_stack.count    = 0;
-    cpu->chip8_stack.slots    = malloc(sizeof(uint8_t)*cpu->chip8_stack.capacity);
-    if (cpu->chip8_stack.slots == NULL) {
-        fprintf(stderr, "[ERROR] Memory Allocation for Stack Slots Failed\n");
-        return false;
-    }
-
-    // Initialize Sound Structure
-    cpu->sound.sample_rate = CHIP8_SOUND_SAMPLES;
-    cpu->sound.duration    = CHIP8_SOUND_DURATION;
-    cpu->sound.amplitude   = CHIP8_SOUND_AMPLITUDE;
-    cpu->sound.frequency   = CHIP8_SOUND_FREQUENCY;
-    cpu->sound.playing     = false;
-    cpu->sound.wave.count    = 0;
-    cpu->sound.wave.capacity = cpu->sound.sample_rate*cpu->sound.duration;
-    cpu->sound.wave.samples  = malloc(sizeof(double)*cpu->sound.wave.capacity);
-    if (cpu->sound.wave.samples == NULL) {
-        fprintf(stderr, "[ERROR] Memory Allocation for Samples Failed\n");
-        return false;
-    }
-
-    // Clear Display
-    chip8_clear_display(cpu);
+    chip8_seed_random(cpu, CHIP8_RNG_SEED);
 
     // Load Fontset into chip8 memory
     chip8_load_fontset(cpu);
+    memcpy(cpu->chip8_base_memory, cpu->chip8_memory, sizeof(cpu->chip8_base_memory));
+}
 
-    // Generate Sound Wave samples
-    chip8_generate_sound_wave(cpu);
+static uint32_t chip8_hash_rom(const uint8_t *rom, size_t size)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= rom[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
 
-    // Load the chip8 Rom into chip8 ram
-    if (!chip8_read_file_into_memory(cpu, chip8_rom_path, size)) return false;
+bool chip8_load_rom(Chip8_CPU *cpu, const uint8_t *rom, size_t size)
+{
+    size_t max_size = CHIP8_RAM_CAP - CHIP8_PROGRAM_ENTRY;
+    if (size == 0 || size > max_size) return false;
 
-    // Open Audio Device
-    if (!chip8_open_audio_device(cpu)) return false;
+    memcpy(&cpu->chip8_memory[CHIP8_PROGRAM_ENTRY], rom, size);
+    memcpy(&cpu->chip8_base_memory[CHIP8_PROGRAM_ENTRY], rom, size);
+    cpu->chip8_rom_size = (uint16_t)size;
+    cpu->chip8_rom_hash = chip8_hash_rom(rom, size);
+    chip8_invalidate_decoded(cpu);
     return true;
 }
 
-#define chip8_main main
-int chip8_main(int argc, char **argv)
+bool chip8_read_file_into_memory(Chip8_CPU *cpu, const char *chip8_file_path)
 {
-    srand(time(NULL));
-
-    // Parse Command-Line Args
-    const char *program_name = chip8_shift_args(&argc, &argv);
-    if (argc <= 0) {
-        fprintf(stderr, "[Usage] %s <input_path>\n", program_name);
-        return 1;
+    FILE *fp = fopen(chip8_file_path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "[ERROR] Could not read `%s`: `%s`\n", chip8_file_path, strerror(errno));
+        return false;
     }
 
-    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
-        CHIP8_SDL_ERROR("Failed to Initialize SDL", 1);
+    int ret = fseek(fp, 0, SEEK_END);
+    if (ret < 0) {
+        fprintf(stderr, "[ERROR] Could not seek to end of `%s`: `%s`\n", chip8_file_path, strerror(errno));
+        fclose(fp);
+        return false;
     }
 
-    const char *prefix     = "Chip8";
-    const int prefix_len   = strlen(prefix);
-    const char *rom_path   = chip8_shift_args(&argc, &argv);
-    const int rom_path_len = strlen(rom_path);
-
-    const int buffer_len = prefix_len + rom_path_len;
-    char title[buffer_len + 1];
-
-    snprintf(title, buffer_len, "%s - %s", prefix, rom_path);
-    title[buffer_len] = '\0';
-
-    SDL_Window *window = SDL_CreateWindow(title,
-                                          SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                                          CHIP8_WINDOW_WIDTH, CHIP8_WINDOW_HEIGHT,
-                                          SDL_WINDOW_RESIZABLE);
-    if (window == NULL) {
-        CHIP8_SDL_ERROR("Failed to Create Window", 1);
+    long size = ftell(fp);
+    if (size <= 0) {
+        fprintf(stderr, "[ERROR] File `%s` Empty\n", chip8_file_path);
+        fclose(fp);
+        return false;
     }
 
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, 0);
-    if (renderer == NULL) {
-        CHIP8_SDL_ERROR("Failed to Create Renderer", 1);
+    size_t max_size = CHIP8_RAM_CAP - CHIP8_PROGRAM_ENTRY;
+    if ((size_t)size > max_size) {
+        fprintf(stderr, "[ERROR] Cannot Fit %ld bytes: MEMORY CAPACITY: %zu\n", size, max_size);
+        fclose(fp);
+        return false;
     }
 
-    size_t size = 0;
-    static Chip8_CPU cpu = {0};
-    if(!chip8_initialize_states(&cpu, rom_path, &size)) return 1;
-
-    double last_time = (double)SDL_GetTicks();
-    double timer_accumulator = 0.0;
-    double cpu_accumulator   = 0.0;
-
-    const double cpu_step = 1000.0 / CHIP8_CPU_HZ;
-    const double timer_step = 1000.0 / CHIP8_TIMER_HZ;
-
-    bool quit = false;
-    while (!quit) {
-        double now = (double)SDL_GetTicks();
-        double elapsed = now - last_time;
-        last_time = now;
-
-        timer_accumulator += elapsed;
-        cpu_accumulator   += elapsed;
+    rewind(fp); // Rewind the file pointer to the beginning
 
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            switch (event.type) {
-            case SDL_QUIT: quit = true; break;
-            chip8_handle_input(&cpu, &event); break;
-            }
-        }
-        // Update
-        if (!chip8_clear_background(renderer, BLACK)) quit = true;
+    // Read the chip8 rom directly into the chip8 memory
+    size_t bytes = fread(&cpu->chip8_memory[CHIP8_PROGRAM_ENTRY], sizeof(uint8_t), size, fp);
+    fclose(fp); // close file pointer
+    if (bytes != (size_t)size) {
+        fprintf(stderr, "fread() failed: Expected %ld bytes got %zu bytes\n", size, bytes);
+        return false;
+    }
 
-        // Update timers at 60Hz
-        while (timer_accumulator >= timer_step) {
-            timer_accumulator -= timer_step;
+    memcpy(&cpu->chip8_base_memory[CHIP8_PROGRAM_ENTRY], &cpu->chip8_memory[CHIP8_PROGRAM_ENTRY], size);
+    cpu->chip8_rom_size = (uint16_t)size;
+    cpu->chip8_rom_hash = chip8_hash_rom(&cpu->chip8_memory[CHIP8_PROGRAM_ENTRY], size);
+    chip8_invalidate_decoded(cpu);
+    return true;
+}
 
-            if (cpu.chip8_d_timer > 0) cpu.chip8_d_timer--;
-            if (cpu.chip8_s_timer > 0) {
-                cpu.chip8_s_timer--;
-                cpu.sound.playing = true;
-            } else {
-                cpu.sound.playing = false;
-            }
-        }
+void chip8_dump_state(const Chip8_CPU *cpu, FILE *stream)
+{
+    fprintf(stream, "PC: 0X%03X  I: 0X%03X  DT: %u  ST: %u  SP: %u\n",
+            cpu->chip8_pc, cpu->chip8_ir, cpu->chip8_d_timer, cpu->chip8_s_timer, cpu->chip8_stack.count);
+    for (uint8_t i = 0; i < CHIP8_VREG_COUNT; ++i) {
+        fprintf(stream, "V%X: 0X%02X%s", i, cpu->chip8_vregs[i], (i % 8 == 7) ? "\n" : "  ");
+    }
 
-        // Update CPU at 700Hz
-        while (cpu_accumulator >= cpu_step) {
-            cpu_accumulator -= cpu_step;
-            if (!chip8_execute_opcode(&cpu, CHIP8_PROGRAM_ENTRY, size)) quit = true;
+    for (int j = 0; j < CHIP8_DH; ++j) {
+        for (int i = 0; i < CHIP8_DW; ++i) {
+            fputc(chip8_get_frame_buffer(cpu, i, j) ? '#' : '.', stream);
         }
-
-        if (!chip8_render_pixels(&cpu, renderer, GREEN))  quit = true;
-        SDL_RenderPresent(renderer); // Present Frame with Changes
-        SDL_Delay(1);
+        fputc('\n', stream);
     }
-
-    // Cleanup
-    free(cpu.sound.wave.samples);
-    free(cpu.chip8_stack.slots);
-    SDL_CloseAudioDevice(cpu.sound.dev);
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
-    return 0;
 }
@@ -0,0 +1,510 @@
+#ifndef CHIP8_H
+#define CHIP8_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define CHIP8_VREG_COUNT    16       /* V registers count */
+#define CHIP8_STACK_CAP     64       /* Stack capacity */
+#define CHIP8_DW            64       /* Display Width */
+#define CHIP8_DH            32       /* Display Height */
+#define CHIP8_RAM_CAP       (1024*4) /* 4096 Addressable Memory */
+#define CHIP8_PROGRAM_ENTRY 0x200    /* Program Entry Point */
+
+#define CHIP8_FONT_HEIGHT 5 /* FONT HEIGHT - 5 bytes*/
+
+#define CHIP8_RNG_SEED 0x2545F491u /* CXKK generator state after chip8_reset */
+
+#define CHIP8_CPU_HZ   ((double)700.0) /* CPU Speed */
+#define CHIP8_TIMER_HZ ((double)60.0)  /* CPU TIMER */
+
+typedef enum Chip8_Status {
+    CHIP8_OK = 0,
+    CHIP8_FINISHED,        // PC ran past the end of the loaded program
+    CHIP8_UNKNOWN_OPCODE,
+    CHIP8_STACK_OVERFLOW,
+    CHIP8_STACK_UNDERFLOW,
+    CHIP8_OUT_OF_BOUNDS,   // Memory access outside of the 4K RAM
+
+    // Status Count
+    CHIP8_STATUS_COUNT
+} Chip8_Status;
+
+typedef struct Chip8_Stack {
+    uint8_t slots[CHIP8_STACK_CAP];
+    uint8_t count;
+} Chip8_Stack;
+
+typedef enum Chip8_Keys {
+    CHIP8_ZERO = 0x0,
+    CHIP8_ONE,
+    CHIP8_TWO,
+    CHIP8_THREE,
+    CHIP8_FOUR,
+    CHIP8_FIVE,
+    CHIP8_SIX,
+    CHIP8_SEVEN,
+    CHIP8_EIGHT,
+    CHIP8_NINE,
+    CHIP8_A = 0xA,
+    CHIP8_B = 0xB,
+    CHIP8_C = 0xC,
+    CHIP8_D = 0xD,
+    CHIP8_E = 0XE,
+    CHIP8_F = 0XF,
+
+    // Font Count
+    CHIP8_FONT_COUNT
+} Chip8_Keys;
+
+// Instruction classes produced by the decoder
+typedef enum Chip8_Op {
+    CHIP8_OP_UNDECODED = 0, // Decode cache entry is empty
+    CHIP8_OP_UNKNOWN,
+    CHIP8_OP_END,           // PC is past the end of the program
+    CHIP8_OP_CLS,           // 00E0
+    CHIP8_OP_RET,           // 00EE
+    CHIP8_OP_JP,            // 1NNN
+    CHIP8_OP_CALL,          // 2NNN
+    CHIP8_OP_SE_BYTE,       // 3XKK
+    CHIP8_OP_SNE_BYTE,      // 4XKK
+    CHIP8_OP_LD_BYTE,       // 6XKK
+    CHIP8_OP_ADD_BYTE,      // 7XKK
+    CHIP8_OP_LD_REG,        // 8XY0
+    CHIP8_OP_OR,            // 8XY1
+    CHIP8_OP_AND,           // 8XY2
+    CHIP8_OP_XOR,           // 8XY3
+    CHIP8_OP_ADD_REG,       // 8XY4
+    CHIP8_OP_SUB,           // 8XY5
+    CHIP8_OP_SHR,           // 8XY6
+    CHIP8_OP_SUBN,          // 8XY7
+    CHIP8_OP_SHL,           // 8XYE
+    CHIP8_OP_SNE_REG,       // 9XY0
+    CHIP8_OP_LD_I,          // ANNN
+    CHIP8_OP_RND,           // CXKK
+    CHIP8_OP_DRW,           // DXYN
+    CHIP8_OP_SKP,           // EX9E
+    CHIP8_OP_LD_VX_DT,      // FX07
+    CHIP8_OP_LD_KEY,        // FX0A
+    CHIP8_OP_LD_DT,         // FX15
+    CHIP8_OP_LD_ST,         // FX18
+    CHIP8_OP_ADD_I,         // FX1E
+    CHIP8_OP_LD_F,          // FX29
+    CHIP8_OP_LD_BCD,        // FX33
+    CHIP8_OP_LD_STORE,      // FX55
+    CHIP8_OP_LD_LOAD,       // FX65
+
+    // Op Count
+    CHIP8_OP_COUNT
+} Chip8_Op;
+
+typedef struct Chip8_CPU Chip8_CPU;
+typedef struct Chip8_Instr Chip8_Instr;
+typedef Chip8_Status (*Chip8_Handler)(Chip8_CPU *cpu, const Chip8_Instr *instr);
+
+// Pre-decoded instruction, one per even address in RAM
+struct Chip8_Instr {
+    Chip8_Handler handler; // NULL until decoded
+    uint16_t nnn;
+    uint8_t  x;
+    uint8_t  y;
+    uint8_t  n;
+    uint8_t  kk;
+    uint8_t  op;           // Chip8_Op
+};
+
+typedef enum Chip8_Engine {
+    CHIP8_ENGINE_CACHED = 0, // Decode cache with handler calls (default)
+    CHIP8_ENGINE_SWITCH,     // Reference interpreter, decodes every instruction
+    CHIP8_ENGINE_THREADED,   // Decode cache with threaded dispatch, see chip8_run_threaded
+    CHIP8_ENGINE_JIT,        // x86-64 basic-block recompiler, see chip8_run_jit
+
+    // Engine Count
+    CHIP8_ENGINE_COUNT
+} Chip8_Engine;
+
+// Instruction set variant. Every profile but LEGACY runs on its own interpreter (src/chip8_quirks.c),
+// whichever engine is selected, and implements 5XY0, BNNN, EXA1 and FX29 as specified
+typedef enum Chip8_Quirks {
+    CHIP8_QUIRKS_LEGACY = 0, // This emulator's original behaviour, on every engine (default)
+    CHIP8_QUIRKS_VIP,        // COSMAC VIP: VF reset by 8XY1-3, shifts read Vy, FX55/FX65 leave I past the last register, sprites clip
+    CHIP8_QUIRKS_CHIP48,     // CHIP-48: shifts in place, FX55/FX65 leave I on the last register, BXNN jumps to XNN + VX, sprites clip
+    CHIP8_QUIRKS_SCHIP,      // SUPER-CHIP 1.1: as CHIP-48, but FX55/FX65 leave I as it was
+    CHIP8_QUIRKS_XOCHIP,     // XO-CHIP: shifts read Vy, FX55/FX65 leave I past the last register, sprites wrap
+
+    // Profile Count
+    CHIP8_QUIRKS_COUNT
+} Chip8_Quirks;
+
+#define CHIP8_JIT_MAX_BLOCK 32 // Instructions per translated block
+
+// Execution counts collected while Chip8_CPU.chip8_profile is set
+typedef struct Chip8_Profile {
+    uint64_t op_counts[CHIP8_OP_COUNT]; // Instructions executed per op class
+    uint64_t pc_counts[CHIP8_RAM_CAP];  // Instructions executed per address
+    uint64_t idle_cycles;               // Cycles fast-forwarded through idle loops
+    uint64_t draw_pixels;               // Sprite pixels XORed onto the screen by DXYN
+    uint64_t collisions;                // DXYN that turned a pixel off
+} Chip8_Profile;
+
+#define CHIP8_TRACE_MAGIC   "C8TR"
+#define CHIP8_TRACE_VERSION 1
+
+// One executed instruction, 32 bytes. Registers hold their values after the instruction
+typedef struct Chip8_Trace_Record {
+    uint64_t cycle;                     // Instructions executed before this one
+    uint16_t pc;
+    uint16_t opcode;
+    uint16_t ir;                        // I
+    uint16_t changed;                   // Bit x set if the instruction changed Vx
+    uint8_t  vregs[CHIP8_VREG_COUNT];
+} Chip8_Trace_Record;
+
+// Trace file: this header, then `count` records from oldest to newest, in host byte order.
+// A `status` other than CHIP8_OK means the last record is the instruction that failed
+typedef struct Chip8_Trace_Header {
+    char     magic[4];                  // CHIP8_TRACE_MAGIC
+    uint16_t version;                   // CHIP8_TRACE_VERSION
+    uint16_t record_size;               // sizeof(Chip8_Trace_Record)
+    uint32_t status;
+    uint32_t reserved;
+    uint64_t count;                     // Records in the file
+    uint64_t overwritten;               // Older records the ring had no room for
+} Chip8_Trace_Header;
+
+// In-memory ring of the most recent instructions, filled while Chip8_CPU.chip8_tracer is set
+typedef struct Chip8_Tracer {
+    Chip8_Trace_Record *records;
+    uint64_t            capacity;       // Power of two
+    uint64_t            written;        // Records written since the last reset
+} Chip8_Tracer;
+
+// A program translated to C by chip8-recompile (src/recompile.c). `run` has the contract of
+// chip8_run_cycles without the idle skipping, and interprets whatever it has no translation for
+typedef struct Chip8_Aot {
+    uint16_t rom_size;
+    uint32_t rom_hash;
+    Chip8_Status (*run)(Chip8_CPU *cpu, uint64_t n);
+} Chip8_Aot;
+
+// Translated basic block, one slot per even address in RAM.
+// The code lives in a per-thread code cache, so copies of a CPU on the same thread keep sharing their blocks
+// A block runs at most `budget` instructions and returns how many it ran
+typedef uint32_t (*Chip8_Jit_Code)(Chip8_CPU *cpu, uint32_t budget);
+typedef struct Chip8_Jit_Block {
+    Chip8_Jit_Code code;  // NULL until translated
+    uint16_t       count; // Instructions in one pass through the block, 0 when PC has to be interpreted
+} Chip8_Jit_Block;
+
+struct Chip8_CPU {
+    uint8_t  chip8_vregs[CHIP8_VREG_COUNT];          // Registers V0 - V15
+    uint16_t chip8_ir;                               // Index register
+    uint16_t chip8_pc;                               // Program Counter
+
+    uint8_t  chip8_d_timer;                          // Delay Timer
+    uint8_t  chip8_s_timer;                          // Sound Timer
+
+    uint8_t  chip8_memory[CHIP8_RAM_CAP];            // Chip8 RAM
+    uint8_t  chip8_base_memory[CHIP8_RAM_CAP];       // RAM as loaded, fontset and program. Snapshots store RAM against it
+    uint64_t chip8_frame_buffer[CHIP8_DH];           // Frame Buffer, one row per word, MSB is x = 0
+    bool     chip8_key_state[CHIP8_FONT_COUNT];      // ALL false
+
+    Chip8_Stack  chip8_stack;                        // 16-Byte Stack
+    uint16_t     chip8_rom_size;                     // Size of the loaded program
+    uint32_t     chip8_rom_hash;                     // FNV-1a of the loaded program, ties snapshots to it
+    uint64_t     chip8_cycles;                       // Instructions executed
+    uint64_t     chip8_draws;                        // DXYN instructions executed
+    uint32_t     chip8_rng;                          // xorshift32 state behind CXKK, never 0
+    bool         chip8_display_dirty;                // Set by 00E0/DXYN, cleared by the front end once presented
+    bool         chip8_skip_idle;                    // Let chip8_run_cycles fast-forward through idle loops
+    bool         chip8_idle;                         // The last chip8_run_cycles ended in an idle loop
+    Chip8_Profile *chip8_profile;                    // Count executions into this when set, NULL to run at full speed
+    Chip8_Tracer  *chip8_tracer;                     // Record executions into this when set, NULL to run at full speed
+
+    Chip8_Engine chip8_engine;                       // Engine used by chip8_run_cycles
+    Chip8_Quirks chip8_quirks;                       // Instruction set variant, anything but LEGACY overrides chip8_engine
+    const Chip8_Aot *chip8_aot;                      // Translated program run instead of the engine, see chip8_aot_attach
+    // Decode cache, invalidated by chip8_write_memory.
+    // Two guard entries past the end of RAM catch a skip over the last instruction
+    Chip8_Instr  chip8_decoded[CHIP8_RAM_CAP / 2 + 2];
+
+    // JIT blocks, valid while chip8_jit_generation matches the code cache.
+    // Bit N of chip8_jit_pages is set once a block was translated from the 256 bytes at N * 256
+    Chip8_Jit_Block chip8_jit_blocks[CHIP8_RAM_CAP / 2];
+    uint32_t        chip8_jit_generation;
+    uint16_t        chip8_jit_pages;
+
+    uint32_t       *chip8_write_map;                 // When set, chip8_write_memory sets bit loc / 2 in it, see Chip8_Batch
+};
+
+// Reset the CPU to its power-on state with the fontset loaded and no program
+void chip8_reset(Chip8_CPU *cpu);
+
+// Restart the CXKK sequence, 0 selects CHIP8_RNG_SEED
+void chip8_seed_random(Chip8_CPU *cpu, uint32_t seed);
+
+// Copy a program image to CHIP8_PROGRAM_ENTRY
+bool chip8_load_rom(Chip8_CPU *cpu, const uint8_t *rom, size_t size);
+bool chip8_read_file_into_memory(Chip8_CPU *cpu, const char *chip8_file_path);
+
+bool chip8_read_memory(const Chip8_CPU *cpu, const uint16_t loc, uint8_t *data);
+bool chip8_write_memory(Chip8_CPU *cpu, const uint16_t loc, uint8_t data);
+// Copy in a whole RAM image, only the bytes that differ go through chip8_write_memory
+void chip8_restore_memory(Chip8_CPU *cpu, const uint8_t *memory);
+
+uint8_t chip8_get_frame_buffer(const Chip8_CPU *cpu, uint16_t x, uint16_t y);
+bool    chip8_set_frame_buffer(Chip8_CPU *cpu, uint16_t x, uint16_t y, uint8_t data);
+void    chip8_clear_display(Chip8_CPU *cpu);
+
+// Execute the instruction at PC
+Chip8_Status chip8_execute_opcode(Chip8_CPU *cpu);
+
+// Execute the instruction at PC through the decode cache
+Chip8_Status chip8_execute_cached(Chip8_CPU *cpu);
+void chip8_decode(uint16_t opcode, Chip8_Instr *instr);
+void chip8_decode_at(Chip8_CPU *cpu, uint16_t pc); // Fill the cache entry for an even PC
+void chip8_invalidate_decoded(Chip8_CPU *cpu);
+
+// Run up to `n` instructions with threaded dispatch over the decode cache.
+// Produces the same state as chip8_run_cycles with the switch engine.
+Chip8_Status chip8_run_threaded(Chip8_CPU *cpu, uint64_t n);
+
+// Run up to `n` instructions through translated x86-64 blocks, interpreting whatever can't be translated.
+// Same as chip8_run_threaded on other hosts.
+Chip8_Status chip8_run_jit(Chip8_CPU *cpu, uint64_t n);
+void chip8_jit_invalidate(Chip8_CPU *cpu, uint16_t loc); // Drop every block that covers loc
+// Each thread has its own code cache. Unmap the calling thread's, call before a thread that ran the JIT exits
+void chip8_jit_release(void);
+
+// Execute the instruction at PC the way cpu->chip8_quirks has it
+Chip8_Status chip8_execute_quirks(Chip8_CPU *cpu);
+// Run up to `n` instructions on the interpreter built for cpu->chip8_quirks
+Chip8_Status chip8_run_quirks(Chip8_CPU *cpu, uint64_t n);
+
+// Run the loaded program through `aot` from now on, NULL goes back to chip8_engine.
+// Fails if `aot` was translated from a different program
+bool chip8_aot_attach(Chip8_CPU *cpu, const Chip8_Aot *aot);
+
+// Execute up to `n` instructions, stopping early on the first non-OK status.
+// With chip8_skip_idle set, a run that starts in an idle loop (a self jump, FX0A with no key held,
+// or a delay timer poll) counts the passes through it without executing them and sets chip8_idle.
+// That is only exact if keys and timers don't change during the call, so don't let `n` run past
+// the next timer tick.
+Chip8_Status chip8_run_cycles(Chip8_CPU *cpu, uint64_t n);
+bool chip8_in_idle_loop(const Chip8_CPU *cpu); // Whether chip8_run_cycles would skip passes from here
+
+// Run up to `n` instructions through the reference interpreter, counting each one into
+// cpu->chip8_profile and recording it into cpu->chip8_tracer, whichever are set.
+// chip8_run_cycles takes this path instead of the engine while either is set
+Chip8_Status chip8_run_instrumented(Chip8_CPU *cpu, uint64_t n);
+
+// Print the profile as op classes and the hottest `top` addresses, both sorted by count
+void chip8_profile_report(const Chip8_CPU *cpu, FILE *stream, size_t top);
+
+// Allocate room for the last `capacity` instructions, rounded up to a power of two
+bool chip8_tracer_init(Chip8_Tracer *tracer, uint64_t capacity);
+void chip8_tracer_free(Chip8_Tracer *tracer);
+// Write the records held by the ring to `path`, `status` is how the run stopped
+bool chip8_tracer_flush(const Chip8_Tracer *tracer, const char *path, Chip8_Status status);
+
+#define CHIP8_SNAPSHOT_MAGIC    "C8SN"
+#define CHIP8_SNAPSHOT_VERSION  1
+#define CHIP8_SNAPSHOT_MAX_SIZE (1024 + 2 * CHIP8_RAM_CAP) /* Every byte of RAM changed */
+
+// Serialize registers, stack, timers, counters, RNG, frame buffer and the RAM bytes that differ
+// from chip8_base_memory into `data`, little-endian. Returns the size, 0 if `cap` is too small.
+// Key state belongs to the host and is not saved
+size_t chip8_snapshot_save(const Chip8_CPU *cpu, uint8_t *data, size_t cap);
+// Restore a snapshot taken with the same program loaded. Only RAM bytes that differ from the
+// current contents are written, so decode cache entries and JIT blocks elsewhere survive
+bool chip8_snapshot_load(Chip8_CPU *cpu, const uint8_t *data, size_t size);
+bool chip8_snapshot_write_file(const Chip8_CPU *cpu, const char *path);
+bool chip8_snapshot_read_file(Chip8_CPU *cpu, const char *path);
+
+#define CHIP8_REWIND_KEY_INTERVAL 60 /* Frames between full keyframes in the rewind buffer */
+
+// Everything a rewind step restores, compared byte for byte against the previous frame
+typedef struct Chip8_Rewind_State {
+    uint8_t     memory[CHIP8_RAM_CAP];
+    uint64_t    frame_buffer[CHIP8_DH];
+    uint64_t    cycles;
+    uint64_t    draws;
+    uint32_t    rng;
+    uint16_t    ir;
+    uint16_t    pc;
+    uint8_t     vregs[CHIP8_VREG_COUNT];
+    uint8_t     d_timer;
+    uint8_t     s_timer;
+    Chip8_Stack stack;
+} Chip8_Rewind_State;
+
+typedef struct Chip8_Rewind_Entry {
+    uint32_t offset; // Into Chip8_Rewind.data
+    uint32_t size;
+    bool     key;    // Full state, otherwise XOR against the entry before it
+} Chip8_Rewind_Entry;
+
+// Ring of per-frame states, stored as run-length encoded XOR deltas against the previous frame
+// with a full keyframe every CHIP8_REWIND_KEY_INTERVAL frames. The encoded frames share one
+// byte ring, the oldest ones are dropped when either ring is full
+typedef struct Chip8_Rewind {
+    Chip8_Rewind_Entry *entries;
+    size_t              capacity;  // Frames
+    size_t              first;     // Oldest entry
+    size_t              count;
+    uint8_t            *data;
+    size_t              data_size;
+    size_t              data_end;  // Where the next frame is encoded
+    size_t              since_key; // Frames pushed since the last keyframe
+    Chip8_Rewind_State  current;   // State of the newest entry
+    Chip8_Rewind_State  scratch;
+} Chip8_Rewind;
+
+// Keep up to `frames` frames in `bytes` of encoded deltas
+bool chip8_rewind_init(Chip8_Rewind *rewind, size_t frames, size_t bytes);
+void chip8_rewind_free(Chip8_Rewind *rewind);
+// Record the CPU state, call once per frame
+void chip8_rewind_push(Chip8_Rewind *rewind, const Chip8_CPU *cpu);
+// Drop the newest frame and restore the one before it, false once there is nothing left to go back to
+bool chip8_rewind_pop(Chip8_Rewind *rewind, Chip8_CPU *cpu);
+
+#define CHIP8_MOVIE_MAGIC   "C8MV"
+#define CHIP8_MOVIE_VERSION 1
+
+// The keypad as it was from `cycle` on, bit i set while key i is held
+typedef struct Chip8_Movie_Event {
+    uint64_t cycle;
+    uint16_t keys;
+} Chip8_Movie_Event;
+
+// Key changes stamped with the cycle they took effect at. With the same ROM, starting cycle and
+// generator state, replaying them reproduces the run exactly.
+// File: magic[4] version:u16 rom_size:u16 rom_hash:u32 rng:u32 start_cycle:u64 end_cycle:u64
+// count:u32, then per event the cycles since the previous one as a LEB128 varint and keys:u16,
+// all little-endian
+typedef struct Chip8_Movie {
+    Chip8_Movie_Event *events;
+    size_t             count;
+    size_t             capacity;
+    size_t             next;        // Playback position
+    uint16_t           keys;        // Keys after the last event
+    uint16_t           rom_size;
+    uint32_t           rom_hash;
+    uint32_t           rng;         // Chip8_CPU.chip8_rng at start_cycle
+    uint64_t           start_cycle;
+    uint64_t           end_cycle;   // Where the recording stopped
+} Chip8_Movie;
+
+// Start recording from the CPU as it is now, with no keys held
+void chip8_movie_begin(Chip8_Movie *movie, const Chip8_CPU *cpu);
+// Note the keys the CPU sees from `cycle` on, only changes are stored
+bool chip8_movie_record(Chip8_Movie *movie, uint64_t cycle, uint16_t keys);
+// Forget the events from `cycle` on, e.g. after rewinding to it
+void chip8_movie_truncate(Chip8_Movie *movie, uint64_t cycle);
+bool chip8_movie_write(const Chip8_Movie *movie, const char *path);
+bool chip8_movie_read(Chip8_Movie *movie, const char *path);
+void chip8_movie_free(Chip8_Movie *movie);
+// Check the CPU matches the start of the movie and restore the generator state for playback
+bool chip8_movie_start(Chip8_Movie *movie, Chip8_CPU *cpu);
+// Apply the events due by the CPU's cycle count, returns the cycle of the next one or UINT64_MAX.
+// Don't run past it: chip8_run_cycles expects the keys to stay put for the whole call
+uint64_t chip8_movie_play(Chip8_Movie *movie, Chip8_CPU *cpu);
+
+#define CHIP8_BATCH_LANES 16 /* Instances run side by side by a Chip8_Batch */
+
+// Up to CHIP8_BATCH_LANES instances of one program, e.g. the same ROM under different seeds and
+// input. The registers are kept lane by lane, so an instruction that several lanes are at runs once
+// for all of them with vector operations. Instructions that touch memory, the stack or the screen,
+// and lanes that went their own way, run on each lane's CPU through its engine.
+// The register fields of `cpus` are only current after chip8_batch_sync
+typedef struct Chip8_Batch {
+    uint8_t      vregs[CHIP8_VREG_COUNT][CHIP8_BATCH_LANES];
+    uint16_t     ir[CHIP8_BATCH_LANES];
+    uint16_t     pc[CHIP8_BATCH_LANES];
+    uint8_t      d_timer[CHIP8_BATCH_LANES];
+    uint8_t      s_timer[CHIP8_BATCH_LANES];
+    uint32_t     rng[CHIP8_BATCH_LANES];
+    Chip8_Status status[CHIP8_BATCH_LANES];   // A lane stops at its first non-OK status
+    uint32_t     written[CHIP8_RAM_CAP / 64]; // Bit per even address whose word may differ between lanes
+    size_t       count;                       // Lanes in use
+    uint64_t     vector_steps;                // Instructions run for several lanes at once
+    uint64_t     vector_cycles;               // Lane instructions covered by those
+    uint64_t     scalar_cycles;               // Lane instructions run by the lanes' own engines
+    Chip8_CPU    cpus[CHIP8_BATCH_LANES];     // Memory, screen, stack, keys and cycle count of each lane
+} Chip8_Batch;
+
+// Take over the registers of cpus[0] to cpus[count - 1], which have to hold the same program.
+// Call again after changing a lane's CPU
+bool chip8_batch_begin(Chip8_Batch *batch, size_t count);
+// Run up to `n` instructions on every lane, with the same contract as chip8_run_cycles: keys and
+// timers stay put during the call. Returns CHIP8_OK, or the status of the first lane that stopped
+Chip8_Status chip8_batch_run(Chip8_Batch *batch, uint64_t n);
+// chip8_tick_timers on every lane, returns bit i set while lane i's buzzer sounds
+uint32_t chip8_batch_tick_timers(Chip8_Batch *batch);
+// Copy the lane registers back into `cpus`
+void chip8_batch_sync(Chip8_Batch *batch);
+
+#define CHIP8_PAGE_SIZE  256                              /* Bytes of RAM per Chip8_Page */
+#define CHIP8_PAGE_COUNT (CHIP8_RAM_CAP / CHIP8_PAGE_SIZE)
+
+// Refcounted, immutable once shared. The frame buffer is exactly one page too
+typedef struct Chip8_Page {
+    uint32_t refs;
+    uint8_t  data[CHIP8_PAGE_SIZE];
+} Chip8_Page;
+
+// A machine state for tree search, a couple of hundred bytes. Forking a node shares its RAM pages
+// and frame buffer with the parent. Nodes are run by entering them into a Chip8_CPU, and committing
+// the CPU back replaces only the pages that the run wrote to (FX33/FX55) or drew on.
+// Key state belongs to the host and is not part of a node
+typedef struct Chip8_Node {
+    uint8_t     vregs[CHIP8_VREG_COUNT];
+    uint16_t    ir;
+    uint16_t    pc;
+    uint8_t     d_timer;
+    uint8_t     s_timer;
+    Chip8_Stack stack;
+    uint16_t    rom_size;
+    uint32_t    rom_hash;
+    uint32_t    rng;
+    uint64_t    cycles;
+    uint64_t    draws;
+    Chip8_Page *pages[CHIP8_PAGE_COUNT];
+    Chip8_Page *screen;
+} Chip8_Node;
+
+// Take a root node from `cpu`, which copies all of its RAM. Free it with chip8_node_free
+bool chip8_node_capture(Chip8_Node *node, const Chip8_CPU *cpu);
+// Make `child` a copy of `parent` that shares its pages. Safe to call from several threads
+void chip8_node_fork(Chip8_Node *child, const Chip8_Node *parent);
+void chip8_node_free(Chip8_Node *node);
+// Put `cpu` in the state of `node`, which has to be of the same program. Only RAM bytes that differ
+// are written, so entering a node next to the last one keeps the decode cache and JIT blocks
+bool chip8_node_enter(Chip8_CPU *cpu, const Chip8_Node *node);
+// Store the state of `cpu` into `node`. Changed pages that other nodes share are copied first
+bool chip8_node_commit(Chip8_Node *node, const Chip8_CPU *cpu);
+
+// Decrement the delay and sound timers, call at 60Hz. Returns true while the buzzer sounds
+bool chip8_tick_timers(Chip8_CPU *cpu);
+
+// Instruction helpers shared by the execution engines
+Chip8_Status chip8_op_call(Chip8_CPU *cpu, uint16_t nnn);
+Chip8_Status chip8_op_return(Chip8_CPU *cpu);
+uint8_t      chip8_op_random(Chip8_CPU *cpu, uint8_t kk);
+Chip8_Status chip8_op_draw(Chip8_CPU *cpu, uint8_t vidx_x, uint8_t vidx_y, uint8_t n_bytes);
+void         chip8_op_wait_key(Chip8_CPU *cpu, uint8_t v_index);
+Chip8_Status chip8_op_bcd(Chip8_CPU *cpu, uint8_t v_index);
+Chip8_Status chip8_op_store(Chip8_CPU *cpu, uint8_t v_index);
+Chip8_Status chip8_op_load(Chip8_CPU *cpu, uint8_t v_index);
+
+const char *chip8_status_name(Chip8_Status status);
+const char *chip8_engine_name(Chip8_Engine engine);
+const char *chip8_op_name(Chip8_Op op);
+bool chip8_parse_engine(const char *name, Chip8_Engine *engine);
+const char *chip8_quirks_name(Chip8_Quirks quirks);
+bool chip8_parse_quirks(const char *name, Chip8_Quirks *quirks);
+void chip8_dump_state(const Chip8_CPU *cpu, FILE *stream);
+
+#endif // CHIP8_H
@@ -0,0 +1,487 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "chip8.h"
+
+// Lockstep engine over a Chip8_Batch.
+// The lowest lane that still has budget (the lead) gathers the lanes at the same PC into a group.
+// While the instructions only touch registers, timers or I, the group runs them once for all of its
+// lanes on lane-wise vectors, with a mask keeping the other lanes as they are, until a skip sends its
+// lanes different ways. Everything else runs through the lanes' own CPUs, a few instructions at a time,
+// and so do lanes that start the call in an idle loop.
+// A lead that is alone at its PC runs on its CPU to the end of the call, at the speed of its engine.
+// The vectors are GCC vector extensions: SSE2 on any x86-64, AVX2 when built with -mavx2.
+
+typedef uint8_t  Chip8_U8s  __attribute__((vector_size(CHIP8_BATCH_LANES)));
+typedef int8_t   Chip8_M8s  __attribute__((vector_size(CHIP8_BATCH_LANES)));
+typedef uint16_t Chip8_U16s __attribute__((vector_size(2 * CHIP8_BATCH_LANES)));
+typedef int16_t  Chip8_M16s __attribute__((vector_size(2 * CHIP8_BATCH_LANES)));
+typedef uint32_t Chip8_U32s __attribute__((vector_size(4 * CHIP8_BATCH_LANES)));
+typedef int32_t  Chip8_M32s __attribute__((vector_size(4 * CHIP8_BATCH_LANES)));
+
+#if CHIP8_BATCH_LANES % 8 != 0
+#error "The lane masks are reduced 8 lanes at a time"
+#endif
+
+static inline Chip8_U8s chip8_lanes8(const uint8_t *p)
+{
+    Chip8_U8s v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// The wider vectors go through pointers, passing them by value depends on -mavx
+static inline void chip8_lanes16(Chip8_U16s *v, const uint16_t *p)
+{
+    memcpy(v, p, sizeof(*v));
+}
+
+static inline void chip8_lanes32(Chip8_U32s *v, const uint32_t *p)
+{
+    memcpy(v, p, sizeof(*v));
+}
+
+// Store `v` into the lanes set in `m`
+static inline void chip8_update8(uint8_t *p, Chip8_U8s v, Chip8_M8s m)
+{
+    Chip8_U8s keep = chip8_lanes8(p) & ~(Chip8_U8s)m;
+    v = (v & (Chip8_U8s)m) | keep;
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline void chip8_update16(uint16_t *p, const Chip8_U16s *v, Chip8_M8s m)
+{
+    Chip8_U16s m16 = (Chip8_U16s)__builtin_convertvector(m, Chip8_M16s);
+    Chip8_U16s old;
+    chip8_lanes16(&old, p);
+    Chip8_U16s out = (*v & m16) | (old & ~m16);
+    memcpy(p, &out, sizeof(out));
+}
+
+static inline void chip8_update32(uint32_t *p, const Chip8_U32s *v, Chip8_M8s m)
+{
+    Chip8_U32s m32 = (Chip8_U32s)__builtin_convertvector(m, Chip8_M32s);
+    Chip8_U32s old;
+    chip8_lanes32(&old, p);
+    Chip8_U32s out = (*v & m32) | (old & ~m32);
+    memcpy(p, &out, sizeof(out));
+}
+
+// Lanes set in `m`, 8 mask bytes at a time
+static inline unsigned chip8_lane_count(Chip8_M8s m)
+{
+    uint64_t words[CHIP8_BATCH_LANES / 8];
+    memcpy(words, &m, sizeof(words));
+    unsigned bits = 0;
+    for (size_t i = 0; i < CHIP8_BATCH_LANES / 8; ++i) bits += __builtin_popcountll(words[i]);
+    return bits / 8;
+}
+
+// 1 in every lane where the comparison mask is set
+static inline Chip8_U8s chip8_flag8(Chip8_M8s m)
+{
+    return (Chip8_U8s)m & 1;
+}
+
+static void chip8_batch_load_lane(Chip8_Batch *batch, size_t lane)
+{
+    const Chip8_CPU *cpu = &batch->cpus[lane];
+    for (int v = 0; v < CHIP8_VREG_COUNT; ++v) batch->vregs[v][lane] = cpu->chip8_vregs[v];
+    batch->ir[lane]      = cpu->chip8_ir;
+    batch->pc[lane]      = cpu->chip8_pc;
+    batch->d_timer[lane] = cpu->chip8_d_timer;
+    batch->s_timer[lane] = cpu->chip8_s_timer;
+    batch->rng[lane]     = cpu->chip8_rng;
+}
+
+static void chip8_batch_store_lane(Chip8_Batch *batch, size_t lane)
+{
+    Chip8_CPU *cpu = &batch->cpus[lane];
+    for (int v = 0; v < CHIP8_VREG_COUNT; ++v) cpu->chip8_vregs[v] = batch->vregs[v][lane];
+    cpu->chip8_ir      = batch->ir[lane];
+    cpu->chip8_pc      = batch->pc[lane];
+    cpu->chip8_d_timer = batch->d_timer[lane];
+    cpu->chip8_s_timer = batch->s_timer[lane];
+    cpu->chip8_rng     = batch->rng[lane];
+}
+
+bool chip8_batch_begin(Chip8_Batch *batch, size_t count)
+{
+    if (count == 0 || count > CHIP8_BATCH_LANES) {
+        fprintf(stderr, "[ERROR] A batch runs 1 to %d lanes, not %zu\n", CHIP8_BATCH_LANES, count);
+        return false;
+    }
+    for (size_t i = 1; i < count; ++i) {
+        if (batch->cpus[i].chip8_rom_size != batch->cpus[0].chip8_rom_size ||
+            batch->cpus[i].chip8_rom_hash != batch->cpus[0].chip8_rom_hash) {
+            fprintf(stderr, "[ERROR] Every lane of a batch has to run the same program\n");
+            return false;
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (batch->cpus[i].chip8_quirks != CHIP8_QUIRKS_LEGACY) {
+            fprintf(stderr, "[ERROR] A batch only runs the legacy instruction set\n");
+            return false;
+        }
+    }
+
+    memset(batch->vregs, 0, sizeof(batch->vregs));
+    memset(batch->pc, 0, sizeof(batch->pc));
+    memset(batch->written, 0, sizeof(batch->written));
+    batch->count = count;
+    for (size_t i = 0; i < count; ++i) {
+        chip8_batch_load_lane(batch, i);
+        batch->status[i] = CHIP8_OK;
+        batch->cpus[i].chip8_write_map = batch->written;
+    }
+
+    // RAM that differs between lanes already, e.g. after restoring different snapshots
+    for (size_t i = 1; i < count; ++i) {
+        const uint8_t *mem  = batch->cpus[i].chip8_memory;
+        const uint8_t *lead = batch->cpus[0].chip8_memory;
+        for (uint16_t block = 0; block < CHIP8_RAM_CAP; block += 64) {
+            if (memcmp(&mem[block], &lead[block], 64) == 0) continue;
+            for (uint16_t loc = block; loc < block + 64; ++loc) {
+                if (mem[loc] != lead[loc]) batch->written[loc >> 6] |= 1u << ((loc >> 1) & 31);
+            }
+        }
+    }
+    return true;
+}
+
+void chip8_batch_sync(Chip8_Batch *batch)
+{
+    for (size_t i = 0; i < batch->count; ++i) chip8_batch_store_lane(batch, i);
+}
+
+uint32_t chip8_batch_tick_timers(Chip8_Batch *batch)
+{
+    Chip8_U8s d = chip8_lanes8(batch->d_timer);
+    Chip8_U8s s = chip8_lanes8(batch->s_timer);
+    Chip8_M8s sounding = s > 0;
+    d -= chip8_flag8(d > 0);
+    s -= chip8_flag8(sounding);
+    memcpy(batch->d_timer, &d, sizeof(d));
+    memcpy(batch->s_timer, &s, sizeof(s));
+
+    uint32_t lanes = 0;
+    for (size_t i = 0; i < batch->count; ++i) {
+        if (sounding[i]) lanes |= 1u << i;
+    }
+    return lanes;
+}
+
+// Lane-wise key bitmask, bit k set while key k is held
+static void chip8_batch_keys(const Chip8_Batch *batch, Chip8_U16s *keys)
+{
+    *keys = (Chip8_U16s){0};
+    for (size_t i = 0; i < batch->count; ++i) {
+        uint16_t bits = 0;
+        for (uint8_t k = 0; k < CHIP8_FONT_COUNT; ++k) bits |= (uint16_t)batch->cpus[i].chip8_key_state[k] << k;
+        (*keys)[i] = bits;
+    }
+}
+
+typedef enum Chip8_Batch_Step {
+    CHIP8_BATCH_NEXT = 0, // Ran, the lanes are still together
+    CHIP8_BATCH_SPLIT,    // Ran, a skip sent the lanes different ways and each has its own PC now
+    CHIP8_BATCH_SCALAR,   // Has to run on the lanes' CPUs
+} Chip8_Batch_Step;
+
+// A skip keeps the group together if every lane takes it or none does
+static Chip8_Batch_Step chip8_batch_skip(Chip8_Batch *batch, Chip8_M8s m, Chip8_M8s taken, unsigned lanes, uint16_t *pc)
+{
+    unsigned count = chip8_lane_count(taken & m);
+    if (count == 0 || count == lanes) {
+        *pc += count == 0 ? 2 : 4;
+        return CHIP8_BATCH_NEXT;
+    }
+    Chip8_U16s next = (Chip8_U16s){0} + (uint16_t)(*pc + 2);
+    next += (Chip8_U16s)__builtin_convertvector(taken, Chip8_M16s) & 2;
+    chip8_update16(batch->pc, &next, m);
+    return CHIP8_BATCH_SPLIT;
+}
+
+// Run the instruction at `pc` for the `lanes` lanes in `m` and move `pc` past it.
+// Register reads and writes happen in the same order as in chip8_ops.h, which matters when x or y is F
+static Chip8_Batch_Step chip8_batch_vector(Chip8_Batch *batch, const Chip8_Instr *in, Chip8_M8s m, unsigned lanes,
+                                           uint16_t *pc, Chip8_U16s *keys, bool *have_keys)
+{
+    uint8_t *vx = batch->vregs[in->x];
+    uint8_t *vy = batch->vregs[in->y];
+    uint8_t *vf = batch->vregs[0XF];
+
+    switch (in->op) {
+    case CHIP8_OP_JP:
+        *pc = in->nnn;
+        return CHIP8_BATCH_NEXT;
+    case CHIP8_OP_SE_BYTE:
+        return chip8_batch_skip(batch, m, chip8_lanes8(vx) == in->kk, lanes, pc);
+    case CHIP8_OP_SNE_BYTE:
+        return chip8_batch_skip(batch, m, chip8_lanes8(vx) != in->kk, lanes, pc);
+    case CHIP8_OP_SNE_REG:
+        return chip8_batch_skip(batch, m, chip8_lanes8(vx) != chip8_lanes8(vy), lanes, pc);
+    case CHIP8_OP_SKP: {
+        Chip8_U8s key = chip8_lanes8(vx) & 0XF;
+        if (!*have_keys) {
+            chip8_batch_keys(batch, keys);
+            *have_keys = true;
+        }
+        Chip8_U16s held = (*keys >> __builtin_convertvector(key, Chip8_U16s)) & 1;
+        return chip8_batch_skip(batch, m, __builtin_convertvector(held != 0, Chip8_M8s), lanes, pc);
+    }
+    case CHIP8_OP_LD_BYTE:
+        chip8_update8(vx, (Chip8_U8s){0} + in->kk, m);
+        break;
+    case CHIP8_OP_ADD_BYTE:
+        chip8_update8(vx, chip8_lanes8(vx) + in->kk, m);
+        break;
+    case CHIP8_OP_LD_REG:
+        chip8_update8(vx, chip8_lanes8(vy), m);
+        break;
+    case CHIP8_OP_OR:
+        chip8_update8(vx, chip8_lanes8(vx) | chip8_lanes8(vy), m);
+        break;
+    case CHIP8_OP_AND:
+        chip8_update8(vx, chip8_lanes8(vx) & chip8_lanes8(vy), m);
+        break;
+    case CHIP8_OP_XOR:
+        chip8_update8(vx, chip8_lanes8(vx) ^ chip8_lanes8(vy), m);
+        break;
+    case CHIP8_OP_ADD_REG: {
+        Chip8_U8s a   = chip8_lanes8(vx);
+        Chip8_U8s sum = a + chip8_lanes8(vy);
+        chip8_update8(vf, chip8_flag8(sum < a), m);
+        chip8_update8(vx, sum, m);
+        break;
+    }
+    case CHIP8_OP_SUB:
+        chip8_update8(vf, chip8_flag8(chip8_lanes8(vx) > chip8_lanes8(vy)), m);
+        chip8_update8(vx, chip8_lanes8(vx) - chip8_lanes8(vy), m);
+        break;
+    case CHIP8_OP_SHR:
+        chip8_update8(vf, chip8_lanes8(vx) & 1, m);
+        chip8_update8(vx, chip8_lanes8(vx) >> 1, m);
+        break;
+    case CHIP8_OP_SUBN:
+        chip8_update8(vf, chip8_flag8(chip8_lanes8(vy) > chip8_lanes8(vx)), m);
+        chip8_update8(vx, chip8_lanes8(vy) - chip8_lanes8(vx), m);
+        break;
+    case CHIP8_OP_SHL:
+        chip8_update8(vf, chip8_lanes8(vx) >> 7, m);
+        chip8_update8(vx, chip8_lanes8(vx) << 1, m);
+        break;
+    case CHIP8_OP_LD_I: {
+        Chip8_U16s ir = (Chip8_U16s){0} + in->nnn;
+        chip8_update16(batch->ir, &ir, m);
+        break;
+    }
+    case CHIP8_OP_ADD_I: {
+        Chip8_U16s ir;
+        chip8_lanes16(&ir, batch->ir);
+        ir += __builtin_convertvector(chip8_lanes8(vx), Chip8_U16s);
+        chip8_update16(batch->ir, &ir, m);
+        break;
+    }
+    case CHIP8_OP_LD_F: {
+        Chip8_U16s ir = __builtin_convertvector(chip8_lanes8(vx), Chip8_U16s);
+        chip8_update16(batch->ir, &ir, m);
+        break;
+    }
+    case CHIP8_OP_RND: {
+        // chip8_gen_random_byte on every lane
+        Chip8_U32s x;
+        chip8_lanes32(&x, batch->rng);
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        chip8_update32(batch->rng, &x, m);
+        chip8_update8(vx, __builtin_convertvector(x >> 24, Chip8_U8s) & in->kk, m);
+        break;
+    }
+    case CHIP8_OP_LD_VX_DT:
+        chip8_update8(vx, chip8_lanes8(batch->d_timer), m);
+        break;
+    case CHIP8_OP_LD_DT:
+        chip8_update8(batch->d_timer, chip8_lanes8(vx), m);
+        break;
+    case CHIP8_OP_LD_ST:
+        chip8_update8(batch->s_timer, chip8_lanes8(vx), m);
+        break;
+    default:
+        return CHIP8_BATCH_SCALAR;
+    }
+
+    *pc += 2;
+    return CHIP8_BATCH_NEXT;
+}
+
+// Whether some lane wrote to the instruction at `pc`
+static bool chip8_batch_written(const Chip8_Batch *batch, uint16_t pc)
+{
+    uint16_t end = pc + 1;
+    return (batch->written[pc >> 6] & (1u << ((pc >> 1) & 31))) ||
+           (batch->written[end >> 6] & (1u << ((end >> 1) & 31)));
+}
+
+// The lead's instruction at `pc`, which is inside the program. Odd addresses are not in the decode cache
+static const Chip8_Instr *chip8_batch_fetch(Chip8_CPU *cpu, uint16_t pc, Chip8_Instr *local)
+{
+    if (pc & 1) {
+        chip8_decode((uint16_t)(cpu->chip8_memory[pc] << 8 | cpu->chip8_memory[pc + 1]), local);
+        return local;
+    }
+    Chip8_Instr *in = &cpu->chip8_decoded[pc >> 1];
+    if (in->handler == NULL) chip8_decode_at(cpu, pc);
+    return in;
+}
+
+// Some lane wrote to the instruction at `pc`, keep the lanes holding the same one as the lead
+static Chip8_M8s chip8_batch_same_code(const Chip8_Batch *batch, Chip8_M8s m, size_t lead, uint16_t pc)
+{
+    const uint8_t *code = &batch->cpus[lead].chip8_memory[pc];
+    for (size_t i = lead + 1; i < batch->count; ++i) {
+        if (m[i] && memcmp(&batch->cpus[i].chip8_memory[pc], code, 2) != 0) m[i] = 0;
+    }
+    return m;
+}
+
+// Run the lanes in `m`, all at the lead's PC, for up to `steps` instructions while they stay together.
+// PC is kept in a scalar until the group breaks up. Returns the instructions run
+static uint32_t chip8_batch_group(Chip8_Batch *batch, size_t lead, Chip8_M8s m, unsigned lanes, uint32_t steps,
+                                  Chip8_U16s *keys, bool *have_keys)
+{
+    Chip8_CPU *cpu = &batch->cpus[lead];
+    uint16_t pc = batch->pc[lead];
+    uint32_t run = 0;
+    Chip8_Batch_Step step = CHIP8_BATCH_NEXT;
+    while (run < steps) {
+        // The end of the program goes through the CPUs
+        if (pc + 2 > CHIP8_PROGRAM_ENTRY + cpu->chip8_rom_size) break;
+        if (chip8_batch_written(batch, pc) && chip8_lane_count(chip8_batch_same_code(batch, m, lead, pc)) != lanes) break;
+
+        Chip8_Instr local;
+        step = chip8_batch_vector(batch, chip8_batch_fetch(cpu, pc, &local), m, lanes, &pc, keys, have_keys);
+        if (step == CHIP8_BATCH_SCALAR) break;
+        run++;
+        if (step == CHIP8_BATCH_SPLIT) break;
+    }
+
+    if (step != CHIP8_BATCH_SPLIT) {
+        Chip8_U16s next = (Chip8_U16s){0} + pc;
+        chip8_update16(batch->pc, &next, m);
+    }
+    batch->vector_steps  += run;
+    batch->vector_cycles += (uint64_t)run * lanes;
+    return run;
+}
+
+// How many instructions from `pc` to run on the lanes' CPUs before trying vectors again: the
+// memory and screen instructions in a row, up to and including the first one that isn't one of them.
+// Lanes that run the same instructions end up at the same PC again
+static uint32_t chip8_batch_stretch(Chip8_CPU *cpu, uint16_t pc, uint32_t steps)
+{
+    uint32_t stretch = 1;
+    for (uint16_t loc = pc; stretch < steps && loc + 2 <= CHIP8_PROGRAM_ENTRY + cpu->chip8_rom_size; loc += 2) {
+        Chip8_Instr local;
+        const Chip8_Instr *in = chip8_batch_fetch(cpu, loc, &local);
+        if (in->op != CHIP8_OP_CLS && in->op != CHIP8_OP_DRW && in->op != CHIP8_OP_LD_BCD &&
+            in->op != CHIP8_OP_LD_STORE && in->op != CHIP8_OP_LD_LOAD) break;
+        if (loc != pc) stretch++;
+    }
+    return stretch;
+}
+
+// Run `n` instructions of one lane on its CPU
+static void chip8_batch_scalar(Chip8_Batch *batch, size_t lane, uint32_t n, Chip8_U32s *remaining, Chip8_U32s *done)
+{
+    Chip8_CPU *cpu = &batch->cpus[lane];
+    cpu->chip8_cycles += (*done)[lane];
+    (*done)[lane] = 0;
+
+    chip8_batch_store_lane(batch, lane);
+    uint64_t before = cpu->chip8_cycles;
+    Chip8_Status status = chip8_run_cycles(cpu, n);
+    chip8_batch_load_lane(batch, lane);
+
+    uint32_t executed = (uint32_t)(cpu->chip8_cycles - before);
+    batch->scalar_cycles += executed;
+    (*remaining)[lane] -= executed;
+    if (status != CHIP8_OK) {
+        batch->status[lane] = status;
+        (*remaining)[lane]  = 0;
+    }
+}
+
+static void chip8_batch_run_lanes(Chip8_Batch *batch, uint32_t n)
+{
+    Chip8_U32s remaining = {0};
+    Chip8_U32s done      = {0}; // Vector instructions per lane not yet added to its cycle count
+    for (size_t i = 0; i < batch->count; ++i) {
+        if (batch->status[i] == CHIP8_OK) remaining[i] = n;
+    }
+
+    // Lanes waiting in an idle loop skip it on their CPUs, as chip8_run_cycles does for a single CPU
+    for (size_t i = 0; i < batch->count; ++i) {
+        if (remaining[i] == 0 || !batch->cpus[i].chip8_skip_idle) continue;
+        chip8_batch_store_lane(batch, i);
+        if (chip8_in_idle_loop(&batch->cpus[i])) chip8_batch_scalar(batch, i, n, &remaining, &done);
+    }
+
+    Chip8_U16s keys = {0};
+    bool have_keys  = false;
+    size_t lead = 0;
+    for (;;) {
+        // Lanes only ever run out of budget, the lead never has to move back
+        while (lead < batch->count && remaining[lead] == 0) lead++;
+        if (lead == batch->count) break;
+
+        uint16_t pc = batch->pc[lead];
+        Chip8_U16s pcs;
+        chip8_lanes16(&pcs, batch->pc);
+        Chip8_M8s m = __builtin_convertvector(pcs == pc, Chip8_M8s) &
+                      __builtin_convertvector(remaining > 0, Chip8_M8s);
+        if (pc + 2 <= CHIP8_RAM_CAP && chip8_batch_written(batch, pc)) m = chip8_batch_same_code(batch, m, lead, pc);
+
+        unsigned lanes = chip8_lane_count(m);
+        if (lanes == 1) {
+            chip8_batch_scalar(batch, lead, remaining[lead], &remaining, &done);
+            continue;
+        }
+
+        uint32_t steps = UINT32_MAX;
+        for (size_t i = lead; i < batch->count; ++i) {
+            if (m[i] && remaining[i] < steps) steps = remaining[i];
+        }
+        uint32_t run = chip8_batch_group(batch, lead, m, lanes, steps, &keys, &have_keys);
+        if (run > 0) {
+            Chip8_U32s step = (Chip8_U32s)__builtin_convertvector(m, Chip8_M32s) & run;
+            remaining -= step;
+            done      += step;
+            continue;
+        }
+
+        // The first instruction can't be run on vectors, nor maybe the ones after it
+        uint32_t stretch = chip8_batch_stretch(&batch->cpus[lead], pc, steps);
+        for (size_t i = lead; i < batch->count; ++i) {
+            if (m[i]) chip8_batch_scalar(batch, i, stretch, &remaining, &done);
+        }
+    }
+
+    for (size_t i = 0; i < batch->count; ++i) batch->cpus[i].chip8_cycles += done[i];
+}
+
+Chip8_Status chip8_batch_run(Chip8_Batch *batch, uint64_t n)
+{
+    while (n > 0) {
+        uint32_t chunk = n > UINT32_MAX ? UINT32_MAX : (uint32_t)n;
+        chip8_batch_run_lanes(batch, chunk);
+        n -= chunk;
+    }
+    for (size_t i = 0; i < batch->count; ++i) {
+        if (batch->status[i] != CHIP8_OK) return batch->status[i];
+    }
+    return CHIP8_OK;
+}
@@ -0,0 +1,119 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "chip8_ops.h"
+
+#define CHIP8_DEFINE_HANDLER(op, name)                                                \
+    static Chip8_Status chip8_handle_##name(Chip8_CPU *cpu, const Chip8_Instr *in) \
+    {                                                                              \
+        return chip8_exec_##name(cpu, in);                                         \
+    }
+CHIP8_FOREACH_OP(CHIP8_DEFINE_HANDLER)
+#undef CHIP8_DEFINE_HANDLER
+
+static const Chip8_Handler chip8_handlers[CHIP8_OP_COUNT] = {
+#define CHIP8_HANDLER_ENTRY(op, name) [op] = chip8_handle_##name,
+    CHIP8_FOREACH_OP(CHIP8_HANDLER_ENTRY)
+#undef CHIP8_HANDLER_ENTRY
+};
+
+static Chip8_Op chip8_classify(uint16_t opcode)
+{
+    switch (((opcode >> 12) & 0XF)) { // switch on first nibble
+    case 0X0:
+        switch ((opcode & 0XFF)) {
+        case 0XE0: return CHIP8_OP_CLS;
+        case 0XEE: return CHIP8_OP_RET;
+        default:   return CHIP8_OP_UNKNOWN;
+        }
+    case 0X1: return CHIP8_OP_JP;
+    case 0X2: return CHIP8_OP_CALL;
+    case 0X3: return CHIP8_OP_SE_BYTE;
+    case 0X4: return CHIP8_OP_SNE_BYTE;
+    case 0X6: return CHIP8_OP_LD_BYTE;
+    case 0X7: return CHIP8_OP_ADD_BYTE;
+    case 0X8:
+        switch ((opcode & 0XF)) {
+        case 0X0: return CHIP8_OP_LD_REG;
+        case 0X1: return CHIP8_OP_OR;
+        case 0X2: return CHIP8_OP_AND;
+        case 0X3: return CHIP8_OP_XOR;
+        case 0X4: return CHIP8_OP_ADD_REG;
+        case 0X5: return CHIP8_OP_SUB;
+        case 0X6: return CHIP8_OP_SHR;
+        case 0X7: return CHIP8_OP_SUBN;
+        case 0XE: return CHIP8_OP_SHL;
+        default:  return CHIP8_OP_UNKNOWN;
+        }
+    case 0X9: return CHIP8_OP_SNE_REG;
+    case 0XA: return CHIP8_OP_LD_I;
+    case 0XC: return CHIP8_OP_RND;
+    case 0XD: return CHIP8_OP_DRW;
+    case 0XE: return CHIP8_OP_SKP;
+    case 0XF:
+        switch ((opcode & 0XFF)) {
+        case 0X07: return CHIP8_OP_LD_VX_DT;
+        case 0X0A: return CHIP8_OP_LD_KEY;
+        case 0X15: return CHIP8_OP_LD_DT;
+        case 0X18: return CHIP8_OP_LD_ST;
+        case 0X1E: return CHIP8_OP_ADD_I;
+        case 0X29: return CHIP8_OP_LD_F;
+        case 0X33: return CHIP8_OP_LD_BCD;
+        case 0X55: return CHIP8_OP_LD_STORE;
+        case 0X65: return CHIP8_OP_LD_LOAD;
+        default:   return CHIP8_OP_UNKNOWN;
+        }
+    default: return CHIP8_OP_UNKNOWN;
+    }
+}
+
+void chip8_decode(uint16_t opcode, Chip8_Instr *instr)
+{
+    Chip8_Op op = chip8_classify(opcode);
+    instr->op      = op;
+    instr->nnn     = opcode & 0X0FFF;
+    instr->x       = (opcode >> 8) & 0XF;
+    instr->y       = (opcode >> 4) & 0XF;
+    instr->n       = opcode & 0XF;
+    instr->kk      = opcode & 0XFF;
+    instr->handler = chip8_handlers[op];
+}
+
+void chip8_decode_at(Chip8_CPU *cpu, uint16_t pc)
+{
+    Chip8_Instr *instr = &cpu->chip8_decoded[pc >> 1];
+    if (pc >= CHIP8_PROGRAM_ENTRY + cpu->chip8_rom_size) {
+        chip8_decode(0x0000, instr);
+        instr->op      = CHIP8_OP_END;
+        instr->handler = chip8_handlers[CHIP8_OP_END];
+        return;
+    }
+
+    uint16_t opcode = (cpu->chip8_memory[pc] << 8) | cpu->chip8_memory[pc + 1];
+    chip8_decode(opcode, instr);
+}
+
+void chip8_invalidate_decoded(Chip8_CPU *cpu)
+{
+    memset(cpu->chip8_decoded, 0, sizeof(cpu->chip8_decoded));
+    // Translated blocks go stale along with the decode cache
+    memset(cpu->chip8_jit_blocks, 0, sizeof(cpu->chip8_jit_blocks));
+    cpu->chip8_jit_pages = 0;
+}
+
+Chip8_Status chip8_execute_cached(Chip8_CPU *cpu)
+{
+    uint16_t pc = cpu->chip8_pc;
+    if (pc >= CHIP8_PROGRAM_ENTRY + cpu->chip8_rom_size) return CHIP8_FINISHED;
+
+    // Only even addresses are cached, a jump to an odd address takes the reference path
+    if (pc & 1) return chip8_execute_opcode(cpu);
+
+    Chip8_Instr *instr = &cpu->chip8_decoded[pc >> 1];
+    if (instr->handler == NULL) chip8_decode_at(cpu, pc);
+
+    cpu->chip8_pc = pc + 2;
+    return instr->handler(cpu, instr);
+}
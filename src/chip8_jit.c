@@ -0,0 +1,646 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+
+// Basic-block recompiler for x86-64.
+// A block is a run of register, timer and index instructions translated to native code, ending after
+// a 1NNN or before anything that can't be translated (2NNN, 00EE, BNNN, DXYN, memory ops, ...).
+// A taken skip leaves the block through a side exit, and a block that jumps back to its own start
+// loops in native code until the budget runs out.
+// The V registers a block uses live in host registers for the whole block and are written back on exit.
+// Anything without a block, or a block longer than the remaining budget, runs one instruction at a
+// time through chip8_execute_cached, which itself falls back to chip8_execute_opcode for odd addresses.
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#define CHIP8_JIT_ENABLED 1
+#else
+#define CHIP8_JIT_ENABLED 0
+#endif
+
+#if CHIP8_JIT_ENABLED
+#include <sys/mman.h>
+
+#define CHIP8_JIT_CACHE_SIZE  (1 << 20) // Bytes of native code shared by every CPU on a thread
+#define CHIP8_JIT_BLOCK_BYTES 8192      // Upper bound on the code emitted for one block
+#define CHIP8_JIT_PAGE_SIZE   4096
+
+typedef enum Chip8_X64_Reg {
+    CHIP8_X64_RAX = 0, CHIP8_X64_RCX, CHIP8_X64_RDX, CHIP8_X64_RBX,
+    CHIP8_X64_RSP,     CHIP8_X64_RBP, CHIP8_X64_RSI, CHIP8_X64_RDI,
+    CHIP8_X64_R8,      CHIP8_X64_R9,  CHIP8_X64_R10, CHIP8_X64_R11,
+    CHIP8_X64_R12,     CHIP8_X64_R13, CHIP8_X64_R14, CHIP8_X64_R15,
+} Chip8_X64_Reg;
+
+// RDI holds the CPU, ESI the budget, EDX the instructions run so far, RAX and RCX are scratch.
+// Caller-saved registers are handed out first
+static const Chip8_X64_Reg chip8_jit_host_regs[] = {
+    CHIP8_X64_R8,  CHIP8_X64_R9,  CHIP8_X64_R10, CHIP8_X64_R11, CHIP8_X64_RBX,
+    CHIP8_X64_RBP, CHIP8_X64_R12, CHIP8_X64_R13, CHIP8_X64_R14, CHIP8_X64_R15,
+};
+#define CHIP8_JIT_HOST_REG_COUNT (sizeof(chip8_jit_host_regs) / sizeof(chip8_jit_host_regs[0]))
+
+// x86 condition codes used by the block exits
+#define CHIP8_X64_CC_AE 0X3
+#define CHIP8_X64_CC_E 0X4
+#define CHIP8_X64_CC_NE 0X5
+#define CHIP8_X64_CC_A 0X7
+
+// Last block emitted at each address along with the instructions it was translated from.
+// CPUs running the same program reuse it instead of emitting their own copy
+typedef struct Chip8_Jit_Shared {
+    Chip8_Jit_Code code;
+    uint16_t       count;
+    uint8_t        source[2 * CHIP8_JIT_MAX_BLOCK];
+} Chip8_Jit_Shared;
+
+// Every thread translates into a code cache of its own, so CPUs running on different threads
+// never flush or patch each other's code
+static __thread struct {
+    uint8_t  *base;
+    size_t    used;
+    uint32_t  generation; // Changed when the cache is flushed, stale CPUs drop their blocks
+    bool      failed;     // No executable memory, run the threaded engine instead
+    Chip8_Jit_Shared *blocks; // CHIP8_RAM_CAP / 2 entries
+} chip8_jit_cache;
+
+// Generations are handed out process-wide, a CPU moved to another thread never finds its
+// generation there and drops the blocks that point into the old thread's cache
+static uint32_t chip8_jit_generations;
+
+static uint32_t chip8_jit_next_generation(void)
+{
+    return __atomic_add_fetch(&chip8_jit_generations, 1, __ATOMIC_RELAXED);
+}
+
+typedef struct Chip8_Jit_Emitter {
+    uint8_t *code;
+    size_t   size;
+    Chip8_X64_Reg host[CHIP8_VREG_COUNT]; // Host register of each V register used by the block
+    uint16_t used;                        // V registers loaded by the block
+    uint16_t written;                     // V registers stored back on exit
+} Chip8_Jit_Emitter;
+
+static bool chip8_jit_callee_saved(Chip8_X64_Reg reg)
+{
+    return reg == CHIP8_X64_RBX || reg == CHIP8_X64_RBP || reg >= CHIP8_X64_R12;
+}
+
+// Marks a PC that starts with an untranslatable instruction, never called
+static uint32_t chip8_jit_interpreted(Chip8_CPU *cpu, uint32_t budget)
+{
+    (void) cpu; (void) budget;
+    return 0;
+}
+
+static void chip8_emit8(Chip8_Jit_Emitter *e, uint8_t byte)
+{
+    e->code[e->size++] = byte;
+}
+
+static void chip8_emit16(Chip8_Jit_Emitter *e, uint16_t value)
+{
+    chip8_emit8(e, value & 0XFF);
+    chip8_emit8(e, value >> 8);
+}
+
+static void chip8_emit32(Chip8_Jit_Emitter *e, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) chip8_emit8(e, (value >> (8 * i)) & 0XFF);
+}
+
+// REX prefix, only emitted when it carries a bit unless `force` (byte access to SIL/BPL)
+static void chip8_emit_rex(Chip8_Jit_Emitter *e, int reg, int rm, bool force)
+{
+    uint8_t rex = 0X40 | ((reg & 8) ? 0X4 : 0) | ((rm & 8) ? 0X1 : 0);
+    if (rex != 0X40 || force) chip8_emit8(e, rex);
+}
+
+static void chip8_emit_modrm(Chip8_Jit_Emitter *e, int mod, int reg, int rm)
+{
+    chip8_emit8(e, (mod << 6) | ((reg & 7) << 3) | (rm & 7));
+}
+
+// <op> r/m32, r32 for the 0X01/0X09/0X21/0X29/0X31/0X39/0X89 family
+static void chip8_emit_rr(Chip8_Jit_Emitter *e, uint8_t opcode, int dst, int src)
+{
+    chip8_emit_rex(e, src, dst, false);
+    chip8_emit8(e, opcode);
+    chip8_emit_modrm(e, 3, src, dst);
+}
+
+// Group 1 ALU op with an imm32: 0 add, 1 or, 4 and, 5 sub, 6 xor, 7 cmp
+static void chip8_emit_alu_imm(Chip8_Jit_Emitter *e, int ext, int dst, uint32_t imm)
+{
+    chip8_emit_rex(e, 0, dst, false);
+    chip8_emit8(e, 0X81);
+    chip8_emit_modrm(e, 3, ext, dst);
+    chip8_emit32(e, imm);
+}
+
+// Shift by an imm8: 4 shl, 5 shr
+static void chip8_emit_shift(Chip8_Jit_Emitter *e, int ext, int dst, uint8_t amount)
+{
+    chip8_emit_rex(e, 0, dst, false);
+    chip8_emit8(e, 0XC1);
+    chip8_emit_modrm(e, 3, ext, dst);
+    chip8_emit8(e, amount);
+}
+
+static void chip8_emit_mov_imm(Chip8_Jit_Emitter *e, int dst, uint32_t imm)
+{
+    chip8_emit_rex(e, 0, dst, false);
+    chip8_emit8(e, 0XB8 + (dst & 7));
+    chip8_emit32(e, imm);
+}
+
+// movzx r32, byte [rdi + offset]
+static void chip8_emit_load8(Chip8_Jit_Emitter *e, int dst, size_t offset)
+{
+    chip8_emit_rex(e, dst, 0, false);
+    chip8_emit8(e, 0X0F);
+    chip8_emit8(e, 0XB6);
+    chip8_emit_modrm(e, 2, dst, CHIP8_X64_RDI);
+    chip8_emit32(e, (uint32_t)offset);
+}
+
+// mov byte [rdi + offset], r8
+static void chip8_emit_store8(Chip8_Jit_Emitter *e, int src, size_t offset)
+{
+    chip8_emit_rex(e, src, 0, true);
+    chip8_emit8(e, 0X88);
+    chip8_emit_modrm(e, 2, src, CHIP8_X64_RDI);
+    chip8_emit32(e, (uint32_t)offset);
+}
+
+// <op> word [rdi + offset], r16: 0X89 mov, 0X01 add
+static void chip8_emit_store16(Chip8_Jit_Emitter *e, uint8_t opcode, int src, size_t offset)
+{
+    chip8_emit8(e, 0X66);
+    chip8_emit_rex(e, src, 0, false);
+    chip8_emit8(e, opcode);
+    chip8_emit_modrm(e, 2, src, CHIP8_X64_RDI);
+    chip8_emit32(e, (uint32_t)offset);
+}
+
+// mov word [rdi + offset], imm16
+static void chip8_emit_store16_imm(Chip8_Jit_Emitter *e, size_t offset, uint16_t imm)
+{
+    chip8_emit8(e, 0X66);
+    chip8_emit8(e, 0XC7);
+    chip8_emit_modrm(e, 2, 0, CHIP8_X64_RDI);
+    chip8_emit32(e, (uint32_t)offset);
+    chip8_emit16(e, imm);
+}
+
+// VF = condition of the last compare, through ECX
+static void chip8_emit_flag(Chip8_Jit_Emitter *e, int cc, int vf)
+{
+    chip8_emit8(e, 0X0F);
+    chip8_emit8(e, 0X90 + cc);
+    chip8_emit_modrm(e, 3, 0, CHIP8_X64_RCX);
+    chip8_emit_rr(e, 0X89, vf, CHIP8_X64_RCX);
+}
+
+static bool chip8_jit_translatable(const Chip8_Instr *in)
+{
+    switch (in->op) {
+    case CHIP8_OP_JP:
+    case CHIP8_OP_SE_BYTE:
+    case CHIP8_OP_SNE_BYTE:
+    case CHIP8_OP_LD_BYTE:
+    case CHIP8_OP_ADD_BYTE:
+    case CHIP8_OP_LD_REG:
+    case CHIP8_OP_OR:
+    case CHIP8_OP_AND:
+    case CHIP8_OP_XOR:
+    case CHIP8_OP_ADD_REG:
+    case CHIP8_OP_SUB:
+    case CHIP8_OP_SHR:
+    case CHIP8_OP_SUBN:
+    case CHIP8_OP_SHL:
+    case CHIP8_OP_SNE_REG:
+    case CHIP8_OP_LD_I:
+    case CHIP8_OP_LD_VX_DT:
+    case CHIP8_OP_LD_DT:
+    case CHIP8_OP_LD_ST:
+    case CHIP8_OP_ADD_I:
+    case CHIP8_OP_LD_F:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Bitmask of the V registers an instruction reads or writes
+static uint16_t chip8_jit_regs_used(const Chip8_Instr *in)
+{
+    switch (in->op) {
+    case CHIP8_OP_JP:
+    case CHIP8_OP_LD_I:
+        return 0;
+    case CHIP8_OP_LD_REG:
+    case CHIP8_OP_OR:
+    case CHIP8_OP_AND:
+    case CHIP8_OP_XOR:
+    case CHIP8_OP_SNE_REG:
+        return (1u << in->x) | (1u << in->y);
+    case CHIP8_OP_ADD_REG:
+    case CHIP8_OP_SUB:
+    case CHIP8_OP_SUBN:
+        return (1u << in->x) | (1u << in->y) | (1u << 0XF);
+    case CHIP8_OP_SHR:
+    case CHIP8_OP_SHL:
+        return (1u << in->x) | (1u << 0XF);
+    default:
+        return 1u << in->x;
+    }
+}
+
+// Bitmask of the V registers an instruction writes
+static uint16_t chip8_jit_regs_written(const Chip8_Instr *in)
+{
+    switch (in->op) {
+    case CHIP8_OP_LD_BYTE:
+    case CHIP8_OP_ADD_BYTE:
+    case CHIP8_OP_LD_REG:
+    case CHIP8_OP_OR:
+    case CHIP8_OP_AND:
+    case CHIP8_OP_XOR:
+    case CHIP8_OP_LD_VX_DT:
+        return 1u << in->x;
+    case CHIP8_OP_ADD_REG:
+    case CHIP8_OP_SUB:
+    case CHIP8_OP_SHR:
+    case CHIP8_OP_SUBN:
+    case CHIP8_OP_SHL:
+        return (1u << in->x) | (1u << 0XF);
+    default:
+        return 0;
+    }
+}
+
+// Emit one instruction. Mirrors the matching case of chip8_execute_opcode, including the order
+// VF and Vx are written in when X is F
+static void chip8_jit_emit_instr(Chip8_Jit_Emitter *e, const Chip8_Instr *in)
+{
+    int vx = e->host[in->x];
+    int vy = e->host[in->y];
+    int vf = e->host[0XF];
+
+    switch (in->op) {
+    case CHIP8_OP_LD_BYTE:
+        chip8_emit_mov_imm(e, vx, in->kk);
+        break;
+    case CHIP8_OP_ADD_BYTE:
+        chip8_emit_alu_imm(e, 0, vx, in->kk);
+        chip8_emit_alu_imm(e, 4, vx, 0XFF);
+        break;
+    case CHIP8_OP_LD_REG: chip8_emit_rr(e, 0X89, vx, vy); break;
+    case CHIP8_OP_OR:     chip8_emit_rr(e, 0X09, vx, vy); break;
+    case CHIP8_OP_AND:    chip8_emit_rr(e, 0X21, vx, vy); break;
+    case CHIP8_OP_XOR:    chip8_emit_rr(e, 0X31, vx, vy); break;
+    case CHIP8_OP_ADD_REG:
+        chip8_emit_rr(e, 0X89, CHIP8_X64_RAX, vx);
+        chip8_emit_rr(e, 0X01, CHIP8_X64_RAX, vy);
+        chip8_emit_rr(e, 0X89, CHIP8_X64_RCX, CHIP8_X64_RAX);
+        chip8_emit_shift(e, 5, CHIP8_X64_RCX, 8);
+        chip8_emit_rr(e, 0X89, vf, CHIP8_X64_RCX);
+        chip8_emit_alu_imm(e, 4, CHIP8_X64_RAX, 0XFF);
+        chip8_emit_rr(e, 0X89, vx, CHIP8_X64_RAX);
+        break;
+    case CHIP8_OP_SUB:
+        chip8_emit_rr(e, 0X31, CHIP8_X64_RCX, CHIP8_X64_RCX);
+        chip8_emit_rr(e, 0X39, vx, vy);
+        chip8_emit_flag(e, CHIP8_X64_CC_A, vf);
+        chip8_emit_rr(e, 0X29, vx, vy);
+        chip8_emit_alu_imm(e, 4, vx, 0XFF);
+        break;
+    case CHIP8_OP_SHR:
+        chip8_emit_rr(e, 0X89, CHIP8_X64_RCX, vx);
+        chip8_emit_alu_imm(e, 4, CHIP8_X64_RCX, 0X01);
+        chip8_emit_rr(e, 0X89, vf, CHIP8_X64_RCX);
+        chip8_emit_shift(e, 5, vx, 1);
+        break;
+    case CHIP8_OP_SUBN:
+        chip8_emit_rr(e, 0X31, CHIP8_X64_RCX, CHIP8_X64_RCX);
+        chip8_emit_rr(e, 0X39, vy, vx);
+        chip8_emit_flag(e, CHIP8_X64_CC_A, vf);
+        chip8_emit_rr(e, 0X89, CHIP8_X64_RAX, vy);
+        chip8_emit_rr(e, 0X29, CHIP8_X64_RAX, vx);
+        chip8_emit_alu_imm(e, 4, CHIP8_X64_RAX, 0XFF);
+        chip8_emit_rr(e, 0X89, vx, CHIP8_X64_RAX);
+        break;
+    case CHIP8_OP_SHL:
+        chip8_emit_rr(e, 0X89, CHIP8_X64_RCX, vx);
+        chip8_emit_shift(e, 5, CHIP8_X64_RCX, 7);
+        chip8_emit_rr(e, 0X89, vf, CHIP8_X64_RCX);
+        chip8_emit_shift(e, 4, vx, 1);
+        chip8_emit_alu_imm(e, 4, vx, 0XFF);
+        break;
+    case CHIP8_OP_LD_I:
+        chip8_emit_store16_imm(e, offsetof(Chip8_CPU, chip8_ir), in->nnn);
+        break;
+    case CHIP8_OP_ADD_I:
+        chip8_emit_store16(e, 0X01, vx, offsetof(Chip8_CPU, chip8_ir));
+        break;
+    case CHIP8_OP_LD_F:
+        chip8_emit_store16(e, 0X89, vx, offsetof(Chip8_CPU, chip8_ir));
+        break;
+    case CHIP8_OP_LD_VX_DT:
+        chip8_emit_load8(e, vx, offsetof(Chip8_CPU, chip8_d_timer));
+        break;
+    case CHIP8_OP_LD_DT:
+        chip8_emit_store8(e, vx, offsetof(Chip8_CPU, chip8_d_timer));
+        break;
+    case CHIP8_OP_LD_ST:
+        chip8_emit_store8(e, vx, offsetof(Chip8_CPU, chip8_s_timer));
+        break;
+    default:
+        // Jumps and skips are emitted by chip8_jit_compile
+        break;
+    }
+}
+
+// Write back the V registers, set PC and return the number of instructions run: EDX + `executed`
+static void chip8_jit_emit_exit(Chip8_Jit_Emitter *e, uint16_t next_pc, uint32_t executed)
+{
+    for (int v = 0; v < CHIP8_VREG_COUNT; ++v) {
+        if (e->written & (1u << v)) chip8_emit_store8(e, e->host[v], offsetof(Chip8_CPU, chip8_vregs) + v);
+    }
+    chip8_emit_store16_imm(e, offsetof(Chip8_CPU, chip8_pc), next_pc);
+    chip8_emit_rr(e, 0X89, CHIP8_X64_RAX, CHIP8_X64_RDX);
+    if (executed != 0) chip8_emit_alu_imm(e, 0, CHIP8_X64_RAX, executed);
+    for (int v = CHIP8_VREG_COUNT - 1; v >= 0; --v) {
+        if ((e->used & (1u << v)) && chip8_jit_callee_saved(e->host[v])) {
+            chip8_emit_rex(e, 0, e->host[v], false);
+            chip8_emit8(e, 0X58 + (e->host[v] & 7)); // pop
+        }
+    }
+    chip8_emit8(e, 0XC3); // ret
+}
+
+// jcc rel32 / jmp rel32 to `target`, or to a later target patched in by chip8_jit_patch
+static size_t chip8_jit_emit_jump(Chip8_Jit_Emitter *e, int cc, size_t target)
+{
+    if (cc < 0) {
+        chip8_emit8(e, 0XE9);
+    } else {
+        chip8_emit8(e, 0X0F);
+        chip8_emit8(e, 0X80 + cc);
+    }
+    size_t field = e->size;
+    chip8_emit32(e, (uint32_t)(target - (field + 4)));
+    return field;
+}
+
+static void chip8_jit_patch(Chip8_Jit_Emitter *e, size_t field, size_t target)
+{
+    uint32_t rel = (uint32_t)(target - (field + 4));
+    for (int i = 0; i < 4; ++i) e->code[field + i] = (rel >> (8 * i)) & 0XFF;
+}
+
+// Flip the pages a block is emitted into between writable and executable
+static bool chip8_jit_protect(size_t offset, int prot)
+{
+    size_t first = offset & ~(size_t)(CHIP8_JIT_PAGE_SIZE - 1);
+    size_t last  = (offset + CHIP8_JIT_BLOCK_BYTES + CHIP8_JIT_PAGE_SIZE - 1) & ~(size_t)(CHIP8_JIT_PAGE_SIZE - 1);
+    if (last > CHIP8_JIT_CACHE_SIZE) last = CHIP8_JIT_CACHE_SIZE;
+    if (mprotect(chip8_jit_cache.base + first, last - first, prot) != 0) {
+        fprintf(stderr, "[ERROR] Could not change JIT code cache protection, using the threaded engine\n");
+        chip8_jit_cache.failed = true;
+        return false;
+    }
+    return true;
+}
+
+// Drop every translated block of every CPU on this thread, done when the code cache is full
+static void chip8_jit_flush(Chip8_CPU *cpu)
+{
+    chip8_jit_cache.used = 0;
+    chip8_jit_cache.generation = chip8_jit_next_generation();
+    memset(chip8_jit_cache.blocks, 0, (CHIP8_RAM_CAP / 2) * sizeof(Chip8_Jit_Shared));
+    memset(cpu->chip8_jit_blocks, 0, sizeof(cpu->chip8_jit_blocks));
+    cpu->chip8_jit_pages      = 0;
+    cpu->chip8_jit_generation = chip8_jit_cache.generation;
+}
+
+static void chip8_jit_compile(Chip8_CPU *cpu, uint16_t pc)
+{
+    Chip8_Jit_Block *block = &cpu->chip8_jit_blocks[pc >> 1];
+    Chip8_Instr instrs[CHIP8_JIT_MAX_BLOCK];
+    uint16_t used    = 0;
+    uint16_t written = 0;
+    uint16_t count   = 0;
+    uint16_t addr    = pc;
+    uint16_t end     = CHIP8_PROGRAM_ENTRY + cpu->chip8_rom_size;
+
+    if (chip8_jit_cache.used + CHIP8_JIT_BLOCK_BYTES > CHIP8_JIT_CACHE_SIZE) chip8_jit_flush(cpu);
+
+    while (count < CHIP8_JIT_MAX_BLOCK && addr < end) {
+        Chip8_Instr *in = &instrs[count];
+        chip8_decode((cpu->chip8_memory[addr] << 8) | cpu->chip8_memory[addr + 1], in);
+        if (!chip8_jit_translatable(in)) break;
+
+        uint16_t regs = used | chip8_jit_regs_used(in);
+        if ((size_t)__builtin_popcount(regs) > CHIP8_JIT_HOST_REG_COUNT) break;
+        used     = regs;
+        written |= chip8_jit_regs_written(in);
+
+        count++;
+        addr += 2;
+        if (in->op == CHIP8_OP_JP) break;
+    }
+
+    cpu->chip8_jit_pages |= 1u << (pc >> 8);
+    if (count == 0) {
+        block->code  = chip8_jit_interpreted;
+        block->count = 0;
+        return;
+    }
+    for (uint16_t page = pc >> 8; page <= ((addr - 1) >> 8); ++page) cpu->chip8_jit_pages |= 1u << page;
+
+    Chip8_Jit_Shared *shared = &chip8_jit_cache.blocks[pc >> 1];
+    if (shared->code != NULL && shared->count == count &&
+        memcmp(shared->source, &cpu->chip8_memory[pc], 2 * count) == 0) {
+        block->code  = shared->code;
+        block->count = count;
+        return;
+    }
+
+    if (!chip8_jit_protect(chip8_jit_cache.used, PROT_READ | PROT_WRITE)) return;
+
+    Chip8_Jit_Emitter e = {
+        .code    = chip8_jit_cache.base + chip8_jit_cache.used,
+        .used    = used,
+        .written = written,
+    };
+
+    // Prologue: assign host registers, save the callee-saved ones and load the V registers
+    size_t next = 0;
+    for (int v = 0; v < CHIP8_VREG_COUNT; ++v) {
+        if (!(used & (1u << v))) continue;
+        e.host[v] = chip8_jit_host_regs[next++];
+        if (chip8_jit_callee_saved(e.host[v])) {
+            chip8_emit_rex(&e, 0, e.host[v], false);
+            chip8_emit8(&e, 0X50 + (e.host[v] & 7)); // push
+        }
+        chip8_emit_load8(&e, e.host[v], offsetof(Chip8_CPU, chip8_vregs) + v);
+    }
+    chip8_emit_rr(&e, 0X31, CHIP8_X64_RDX, CHIP8_X64_RDX);
+
+    // Body. A taken skip leaves through a side exit, emitted after the main one
+    size_t body = e.size;
+    size_t side_exits[CHIP8_JIT_MAX_BLOCK];
+    for (uint16_t i = 0; i < count; ++i) {
+        const Chip8_Instr *in = &instrs[i];
+        switch (in->op) {
+        case CHIP8_OP_SE_BYTE:
+            chip8_emit_alu_imm(&e, 7, e.host[in->x], in->kk);
+            side_exits[i] = chip8_jit_emit_jump(&e, CHIP8_X64_CC_E, 0);
+            break;
+        case CHIP8_OP_SNE_BYTE:
+            chip8_emit_alu_imm(&e, 7, e.host[in->x], in->kk);
+            side_exits[i] = chip8_jit_emit_jump(&e, CHIP8_X64_CC_NE, 0);
+            break;
+        case CHIP8_OP_SNE_REG:
+            chip8_emit_rr(&e, 0X39, e.host[in->x], e.host[in->y]);
+            side_exits[i] = chip8_jit_emit_jump(&e, CHIP8_X64_CC_NE, 0);
+            break;
+        default:
+            chip8_jit_emit_instr(&e, in);
+            break;
+        }
+    }
+
+    const Chip8_Instr *last = &instrs[count - 1];
+    if (last->op == CHIP8_OP_JP && last->nnn == pc) {
+        // The block jumps back to itself: go around again without leaving while the budget
+        // in ESI still has room for a whole pass
+        chip8_emit_alu_imm(&e, 0, CHIP8_X64_RDX, count);
+        chip8_emit_rr(&e, 0X89, CHIP8_X64_RAX, CHIP8_X64_RSI);
+        chip8_emit_rr(&e, 0X29, CHIP8_X64_RAX, CHIP8_X64_RDX);
+        chip8_emit_alu_imm(&e, 7, CHIP8_X64_RAX, count);
+        chip8_jit_emit_jump(&e, CHIP8_X64_CC_AE, body);
+        chip8_jit_emit_exit(&e, pc, 0);
+    } else {
+        chip8_jit_emit_exit(&e, last->op == CHIP8_OP_JP ? last->nnn : addr, count);
+    }
+
+    for (uint16_t i = 0; i < count; ++i) {
+        if (instrs[i].op != CHIP8_OP_SE_BYTE && instrs[i].op != CHIP8_OP_SNE_BYTE &&
+            instrs[i].op != CHIP8_OP_SNE_REG) continue;
+        chip8_jit_patch(&e, side_exits[i], e.size);
+        chip8_jit_emit_exit(&e, pc + 2 * i + 4, i + 1);
+    }
+
+    if (!chip8_jit_protect(chip8_jit_cache.used, PROT_READ | PROT_EXEC)) return;
+    block->code  = (Chip8_Jit_Code)(void *)e.code;
+    block->count = count;
+    shared->code  = block->code;
+    shared->count = count;
+    memcpy(shared->source, &cpu->chip8_memory[pc], 2 * count);
+    chip8_jit_cache.used += (e.size + 15) & ~(size_t)15;
+}
+
+// Map the code cache on first use and drop blocks left over from before the last flush
+static bool chip8_jit_prepare(Chip8_CPU *cpu)
+{
+    if (chip8_jit_cache.failed) return false;
+    if (chip8_jit_cache.base == NULL) {
+        void *base = mmap(NULL, CHIP8_JIT_CACHE_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        Chip8_Jit_Shared *blocks = calloc(CHIP8_RAM_CAP / 2, sizeof(Chip8_Jit_Shared));
+        if (base == MAP_FAILED || blocks == NULL) {
+            fprintf(stderr, "[ERROR] Could not map the JIT code cache, using the threaded engine\n");
+            if (base != MAP_FAILED) munmap(base, CHIP8_JIT_CACHE_SIZE);
+            free(blocks);
+            chip8_jit_cache.failed = true;
+            return false;
+        }
+        chip8_jit_cache.base       = base;
+        chip8_jit_cache.blocks     = blocks;
+        chip8_jit_cache.generation = chip8_jit_next_generation();
+    }
+
+    if (cpu->chip8_jit_generation != chip8_jit_cache.generation) {
+        // Generation 0 is a CPU that hasn't run the JIT since chip8_reset, its blocks are already empty
+        if (cpu->chip8_jit_generation != 0) memset(cpu->chip8_jit_blocks, 0, sizeof(cpu->chip8_jit_blocks));
+        cpu->chip8_jit_pages      = 0;
+        cpu->chip8_jit_generation = chip8_jit_cache.generation;
+    }
+    return true;
+}
+
+Chip8_Status chip8_run_jit(Chip8_CPU *cpu, uint64_t n)
+{
+    if (!chip8_jit_prepare(cpu)) return chip8_run_threaded(cpu, n);
+
+    uint64_t remaining = n;
+    Chip8_Status status = CHIP8_OK;
+    while (remaining > 0) {
+        uint16_t pc = cpu->chip8_pc;
+        if (!(pc & 1) && pc < CHIP8_RAM_CAP) {
+            Chip8_Jit_Block *block = &cpu->chip8_jit_blocks[pc >> 1];
+            if (block->code == NULL) {
+                chip8_jit_compile(cpu, pc);
+                if (chip8_jit_cache.failed) break;
+            }
+            // Only enter a block that fits the budget so the caller's timers stay exact
+            if (block->count != 0 && block->count <= remaining) {
+                remaining -= block->code(cpu, remaining > UINT32_MAX ? UINT32_MAX : (uint32_t)remaining);
+                continue;
+            }
+        }
+
+        status = chip8_execute_cached(cpu);
+        if (status != CHIP8_OK) break;
+        remaining--;
+    }
+    cpu->chip8_cycles += n - remaining;
+
+    if (chip8_jit_cache.failed && status == CHIP8_OK && remaining > 0) {
+        return chip8_run_threaded(cpu, remaining);
+    }
+    return status;
+}
+
+void chip8_jit_invalidate(Chip8_CPU *cpu, uint16_t loc)
+{
+    // A block covering loc starts at most CHIP8_JIT_MAX_BLOCK - 1 instructions before it
+    int first = ((int)loc - 2 * (CHIP8_JIT_MAX_BLOCK - 1)) >> 1;
+    if (first < 0) first = 0;
+    for (int i = first; i <= (loc >> 1) && i < CHIP8_RAM_CAP / 2; ++i) {
+        cpu->chip8_jit_blocks[i].code  = NULL;
+        cpu->chip8_jit_blocks[i].count = 0;
+    }
+}
+
+void chip8_jit_release(void)
+{
+    if (chip8_jit_cache.base != NULL) munmap(chip8_jit_cache.base, CHIP8_JIT_CACHE_SIZE);
+    free(chip8_jit_cache.blocks);
+    memset(&chip8_jit_cache, 0, sizeof(chip8_jit_cache));
+}
+
+#else // !CHIP8_JIT_ENABLED
+
+Chip8_Status chip8_run_jit(Chip8_CPU *cpu, uint64_t n)
+{
+    return chip8_run_threaded(cpu, n);
+}
+
+void chip8_jit_invalidate(Chip8_CPU *cpu, uint16_t loc)
+{
+    (void) cpu; (void) loc;
+}
+
+void chip8_jit_release(void)
+{
+}
+
+#endif // CHIP8_JIT_ENABLED
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "chip8.h"
+
+#define CHIP8_MOVIE_HEADER_SIZE 36
+
+void chip8_movie_begin(Chip8_Movie *movie, const Chip8_CPU *cpu)
+{
+    chip8_movie_free(movie);
+    movie->rom_size    = cpu->chip8_rom_size;
+    movie->rom_hash    = cpu->chip8_rom_hash;
+    movie->rng         = cpu->chip8_rng;
+    movie->start_cycle = cpu->chip8_cycles;
+    movie->end_cycle   = cpu->chip8_cycles;
+}
+
+bool chip8_movie_record(Chip8_Movie *movie, uint64_t cycle, uint16_t keys)
+{
+    if (cycle > movie->end_cycle) movie->end_cycle = cycle;
+    if (keys == movie->keys) return true;
+
+    if (movie->count == movie->capacity) {
+        size_t capacity = movie->capacity > 0 ? movie->capacity * 2 : 256;
+        Chip8_Movie_Event *events = realloc(movie->events, capacity * sizeof(Chip8_Movie_Event));
+        if (events == NULL) {
+            fprintf(stderr, "[ERROR] Memory Allocation for %zu Movie Events Failed\n", capacity);
+            return false;
+        }
+        movie->events   = events;
+        movie->capacity = capacity;
+    }
+    movie->events[movie->count].cycle = cycle;
+    movie->events[movie->count].keys  = keys;
+    movie->count++;
+    movie->keys = keys;
+    return true;
+}
+
+void chip8_movie_truncate(Chip8_Movie *movie, uint64_t cycle)
+{
+    while (movie->count > 0 && movie->events[movie->count - 1].cycle >= cycle) movie->count--;
+    movie->keys      = movie->count > 0 ? movie->events[movie->count - 1].keys : 0;
+    movie->end_cycle = cycle > movie->start_cycle ? cycle : movie->start_cycle;
+}
+
+void chip8_movie_free(Chip8_Movie *movie)
+{
+    free(movie->events);
+    memset(movie, 0, sizeof(Chip8_Movie));
+}
+
+static void chip8_movie_put_le(FILE *fp, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) fputc((value >> (8 * i)) & 0xFF, fp);
+}
+
+static uint64_t chip8_movie_get_le(const uint8_t *data, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) value |= (uint64_t)data[i] << (8 * i);
+    return value;
+}
+
+bool chip8_movie_write(const Chip8_Movie *movie, const char *path)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "[ERROR] Could not write `%s`: `%s`\n", path, strerror(errno));
+        return false;
+    }
+
+    fwrite(CHIP8_MOVIE_MAGIC, 1, 4, fp);
+    chip8_movie_put_le(fp, CHIP8_MOVIE_VERSION, 2);
+    chip8_movie_put_le(fp, movie->rom_size, 2);
+    chip8_movie_put_le(fp, movie->rom_hash, 4);
+    chip8_movie_put_le(fp, movie->rng, 4);
+    chip8_movie_put_le(fp, movie->start_cycle, 8);
+    chip8_movie_put_le(fp, movie->end_cycle, 8);
+    chip8_movie_put_le(fp, movie->count, 4);
+
+    // Key changes come a few hundred cycles apart, which mostly fits in one or two varint bytes
+    uint64_t previous = movie->start_cycle;
+    for (size_t i = 0; i < movie->count; ++i) {
+        uint64_t delta = movie->events[i].cycle - previous;
+        previous = movie->events[i].cycle;
+        do {
+            uint8_t byte = delta & 0x7F;
+            delta >>= 7;
+            fputc(byte | (delta ? 0x80 : 0), fp);
+        } while (delta);
+        chip8_movie_put_le(fp, movie->events[i].keys, 2);
+    }
+
+    bool ok = !ferror(fp);
+    if (fclose(fp) != 0) ok = false;
+    if (!ok) fprintf(stderr, "[ERROR] Could not write `%s`: `%s`\n", path, strerror(errno));
+    return ok;
+}
+
+bool chip8_movie_read(Chip8_Movie *movie, const char *path)
+{
+    memset(movie, 0, sizeof(Chip8_Movie));
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "[ERROR] Could not read `%s`: `%s`\n", path, strerror(errno));
+        return false;
+    }
+
+    uint8_t header[CHIP8_MOVIE_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header) || memcmp(header, CHIP8_MOVIE_MAGIC, 4) != 0) {
+        fprintf(stderr, "[ERROR] `%s` is not a CHIP-8 movie\n", path);
+        fclose(fp);
+        return false;
+    }
+    uint16_t version = (uint16_t)chip8_movie_get_le(&header[4], 2);
+    if (version != CHIP8_MOVIE_VERSION) {
+        fprintf(stderr, "[ERROR] Unsupported movie version %u in `%s`\n", version, path);
+        fclose(fp);
+        return false;
+    }
+    movie->rom_size    = (uint16_t)chip8_movie_get_le(&header[6], 2);
+    movie->rom_hash    = (uint32_t)chip8_movie_get_le(&header[8], 4);
+    movie->rng         = (uint32_t)chip8_movie_get_le(&header[12], 4);
+    movie->start_cycle = chip8_movie_get_le(&header[16], 8);
+    movie->end_cycle   = chip8_movie_get_le(&header[24], 8);
+    uint32_t count     = (uint32_t)chip8_movie_get_le(&header[32], 4);
+
+    uint64_t cycle = movie->start_cycle;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t delta = 0;
+        int c = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            c = fgetc(fp);
+            if (c == EOF) break;
+            delta |= (uint64_t)(c & 0x7F) << shift;
+            if (!(c & 0x80)) break;
+        }
+        int low  = fgetc(fp);
+        int high = fgetc(fp);
+        if (c == EOF || low == EOF || high == EOF) {
+            fprintf(stderr, "[ERROR] `%s` is truncated\n", path);
+            fclose(fp);
+            chip8_movie_free(movie);
+            return false;
+        }
+        cycle += delta;
+        if (!chip8_movie_record(movie, cycle, (uint16_t)(low | (high << 8)))) {
+            fclose(fp);
+            chip8_movie_free(movie);
+            return false;
+        }
+    }
+    fclose(fp);
+
+    // chip8_movie_record moved these along, put back what the header says
+    movie->end_cycle = chip8_movie_get_le(&header[24], 8);
+    movie->keys = 0;
+    return true;
+}
+
+bool chip8_movie_start(Chip8_Movie *movie, Chip8_CPU *cpu)
+{
+    if (movie->rom_size != cpu->chip8_rom_size || movie->rom_hash != cpu->chip8_rom_hash) {
+        fprintf(stderr, "[ERROR] Movie was recorded with a different program loaded\n");
+        return false;
+    }
+    if (movie->start_cycle != cpu->chip8_cycles) {
+        fprintf(stderr, "[ERROR] Movie starts at cycle %lu, the CPU is at cycle %lu\n",
+                (unsigned long)movie->start_cycle, (unsigned long)cpu->chip8_cycles);
+        return false;
+    }
+
+    chip8_seed_random(cpu, movie->rng);
+    memset(cpu->chip8_key_state, 0, sizeof(cpu->chip8_key_state));
+    movie->next = 0;
+    movie->keys = 0;
+    return true;
+}
+
+uint64_t chip8_movie_play(Chip8_Movie *movie, Chip8_CPU *cpu)
+{
+    while (movie->next < movie->count && movie->events[movie->next].cycle <= cpu->chip8_cycles) {
+        movie->keys = movie->events[movie->next++].keys;
+        for (uint8_t i = 0; i < CHIP8_FONT_COUNT; ++i) cpu->chip8_key_state[i] = (movie->keys >> i) & 1;
+    }
+    return movie->next < movie->count ? movie->events[movie->next].cycle : UINT64_MAX;
+}
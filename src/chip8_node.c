@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+
+// Pages are only ever written while one node holds them, so sharing them between threads only
+// takes the reference counts to be atomic
+
+static Chip8_Page *chip8_page_new(const void *data)
+{
+    Chip8_Page *page = malloc(sizeof(Chip8_Page));
+    if (page == NULL) {
+        fprintf(stderr, "[ERROR] Memory Allocation for a %d Byte Page Failed\n", CHIP8_PAGE_SIZE);
+        return NULL;
+    }
+    page->refs = 1;
+    memcpy(page->data, data, CHIP8_PAGE_SIZE);
+    return page;
+}
+
+static void chip8_page_retain(Chip8_Page *page)
+{
+    __atomic_add_fetch(&page->refs, 1, __ATOMIC_RELAXED);
+}
+
+static void chip8_page_release(Chip8_Page *page)
+{
+    if (page != NULL && __atomic_sub_fetch(&page->refs, 1, __ATOMIC_ACQ_REL) == 0) free(page);
+}
+
+static bool chip8_page_shared(const Chip8_Page *page)
+{
+    return __atomic_load_n(&page->refs, __ATOMIC_ACQUIRE) > 1;
+}
+
+static void chip8_node_store_registers(Chip8_Node *node, const Chip8_CPU *cpu)
+{
+    memcpy(node->vregs, cpu->chip8_vregs, CHIP8_VREG_COUNT);
+    node->ir       = cpu->chip8_ir;
+    node->pc       = cpu->chip8_pc;
+    node->d_timer  = cpu->chip8_d_timer;
+    node->s_timer  = cpu->chip8_s_timer;
+    node->stack    = cpu->chip8_stack;
+    node->rom_size = cpu->chip8_rom_size;
+    node->rom_hash = cpu->chip8_rom_hash;
+    node->rng      = cpu->chip8_rng;
+    node->cycles   = cpu->chip8_cycles;
+    node->draws    = cpu->chip8_draws;
+}
+
+bool chip8_node_capture(Chip8_Node *node, const Chip8_CPU *cpu)
+{
+    memset(node, 0, sizeof(Chip8_Node));
+    chip8_node_store_registers(node, cpu);
+    for (int p = 0; p < CHIP8_PAGE_COUNT; ++p) {
+        node->pages[p] = chip8_page_new(&cpu->chip8_memory[p * CHIP8_PAGE_SIZE]);
+        if (node->pages[p] == NULL) {
+            chip8_node_free(node);
+            return false;
+        }
+    }
+    node->screen = chip8_page_new(cpu->chip8_frame_buffer);
+    if (node->screen == NULL) {
+        chip8_node_free(node);
+        return false;
+    }
+    return true;
+}
+
+void chip8_node_fork(Chip8_Node *child, const Chip8_Node *parent)
+{
+    *child = *parent;
+    for (int p = 0; p < CHIP8_PAGE_COUNT; ++p) chip8_page_retain(child->pages[p]);
+    chip8_page_retain(child->screen);
+}
+
+void chip8_node_free(Chip8_Node *node)
+{
+    for (int p = 0; p < CHIP8_PAGE_COUNT; ++p) chip8_page_release(node->pages[p]);
+    chip8_page_release(node->screen);
+    memset(node, 0, sizeof(Chip8_Node));
+}
+
+bool chip8_node_enter(Chip8_CPU *cpu, const Chip8_Node *node)
+{
+    if (node->rom_size != cpu->chip8_rom_size || node->rom_hash != cpu->chip8_rom_hash) {
+        fprintf(stderr, "[ERROR] Node was taken with a different program loaded\n");
+        return false;
+    }
+
+    memcpy(cpu->chip8_vregs, node->vregs, CHIP8_VREG_COUNT);
+    cpu->chip8_ir      = node->ir;
+    cpu->chip8_pc      = node->pc;
+    cpu->chip8_d_timer = node->d_timer;
+    cpu->chip8_s_timer = node->s_timer;
+    cpu->chip8_stack   = node->stack;
+    cpu->chip8_rng     = node->rng;
+    cpu->chip8_cycles  = node->cycles;
+    cpu->chip8_draws   = node->draws;
+
+    for (int p = 0; p < CHIP8_PAGE_COUNT; ++p) {
+        const uint8_t *data = node->pages[p]->data;
+        uint16_t base = (uint16_t)(p * CHIP8_PAGE_SIZE);
+        if (memcmp(&cpu->chip8_memory[base], data, CHIP8_PAGE_SIZE) == 0) continue;
+        for (uint16_t i = 0; i < CHIP8_PAGE_SIZE; ++i) {
+            if (cpu->chip8_memory[base + i] != data[i]) chip8_write_memory(cpu, base + i, data[i]);
+        }
+    }
+
+    if (memcmp(cpu->chip8_frame_buffer, node->screen->data, CHIP8_PAGE_SIZE) != 0) {
+        memcpy(cpu->chip8_frame_buffer, node->screen->data, CHIP8_PAGE_SIZE);
+        cpu->chip8_display_dirty = true;
+    }
+    return true;
+}
+
+// Point `*slot` at a page holding `data`: `spare` if a copy was made, otherwise the page
+// itself, which this node holds alone and can rewrite in place
+static void chip8_node_update_page(Chip8_Page **slot, const void *data, Chip8_Page *spare)
+{
+    if (spare != NULL) {
+        chip8_page_release(*slot);
+        *slot = spare;
+    } else if (memcmp((*slot)->data, data, CHIP8_PAGE_SIZE) != 0) {
+        memcpy((*slot)->data, data, CHIP8_PAGE_SIZE);
+    }
+}
+
+bool chip8_node_commit(Chip8_Node *node, const Chip8_CPU *cpu)
+{
+    // Allocate every copy up front, so the node is left as it was if one fails
+    Chip8_Page *spares[CHIP8_PAGE_COUNT + 1] = {0};
+    bool ok = true;
+    for (int p = 0; p <= CHIP8_PAGE_COUNT && ok; ++p) {
+        Chip8_Page *page = p < CHIP8_PAGE_COUNT ? node->pages[p] : node->screen;
+        const void *data = p < CHIP8_PAGE_COUNT ? (const void*)&cpu->chip8_memory[p * CHIP8_PAGE_SIZE]
+                                                : (const void*)cpu->chip8_frame_buffer;
+        if (!chip8_page_shared(page) || memcmp(page->data, data, CHIP8_PAGE_SIZE) == 0) continue;
+        spares[p] = chip8_page_new(data);
+        ok = spares[p] != NULL;
+    }
+    if (!ok) {
+        for (int p = 0; p <= CHIP8_PAGE_COUNT; ++p) free(spares[p]);
+        return false;
+    }
+
+    chip8_node_store_registers(node, cpu);
+    for (int p = 0; p < CHIP8_PAGE_COUNT; ++p) {
+        chip8_node_update_page(&node->pages[p], &cpu->chip8_memory[p * CHIP8_PAGE_SIZE], spares[p]);
+    }
+    chip8_node_update_page(&node->screen, cpu->chip8_frame_buffer, spares[CHIP8_PAGE_COUNT]);
+    return true;
+}
@@ -0,0 +1,249 @@
+#ifndef CHIP8_OPS_H
+#define CHIP8_OPS_H
+
+// Instruction bodies for the engines that run from the decode cache.
+// Each one mirrors a case of chip8_execute_opcode and runs with PC already advanced past the instruction.
+// Internal to libchip8: included by the engines, not installed with chip8.h
+
+#include <stdint.h>
+
+#include "chip8.h"
+
+static inline Chip8_Status chip8_exec_unknown(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    (void) cpu; (void) in;
+    return CHIP8_UNKNOWN_OPCODE;
+}
+
+static inline Chip8_Status chip8_exec_end(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    (void) in;
+    cpu->chip8_pc -= 2; // Not executed, leave PC where the program ran out
+    return CHIP8_FINISHED;
+}
+
+static inline Chip8_Status chip8_exec_cls(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    (void) in;
+    chip8_clear_display(cpu);
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_ret(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    (void) in;
+    return chip8_op_return(cpu);
+}
+
+static inline Chip8_Status chip8_exec_jp(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_pc = in->nnn;
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_call(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    return chip8_op_call(cpu, in->nnn);
+}
+
+static inline Chip8_Status chip8_exec_se_byte(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    if (cpu->chip8_vregs[in->x] == in->kk) cpu->chip8_pc += 2;
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_sne_byte(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    if (cpu->chip8_vregs[in->x] != in->kk) cpu->chip8_pc += 2;
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_ld_byte(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_vregs[in->x] = in->kk;
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_add_byte(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_vregs[in->x] += in->kk;
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_ld_reg(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_vregs[in->x] = cpu->chip8_vregs[in->y];
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_or(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_vregs[in->x] |= cpu->chip8_vregs[in->y];
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_and(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_vregs[in->x] &= cpu->chip8_vregs[in->y];
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_xor(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_vregs[in->x] ^= cpu->chip8_vregs[in->y];
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_add_reg(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    uint16_t value = (uint16_t) cpu->chip8_vregs[in->x] + (uint16_t) cpu->chip8_vregs[in->y];
+    cpu->chip8_vregs[0XF]   = value > UINT8_MAX;
+    cpu->chip8_vregs[in->x] = value & 0xFF;
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_sub(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_vregs[0XF]    = cpu->chip8_vregs[in->x] > cpu->chip8_vregs[in->y];
+    cpu->chip8_vregs[in->x] -= cpu->chip8_vregs[in->y];
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_shr(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_vregs[0XF]     = cpu->chip8_vregs[in->x] & 0x01;
+    cpu->chip8_vregs[in->x] >>= 1;
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_subn(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_vregs[0XF]   = cpu->chip8_vregs[in->y] > cpu->chip8_vregs[in->x];
+    cpu->chip8_vregs[in->x] = cpu->chip8_vregs[in->y] - cpu->chip8_vregs[in->x];
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_shl(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_vregs[0XF]     = (cpu->chip8_vregs[in->x] & 0x80) != 0;
+    cpu->chip8_vregs[in->x] <<= 1;
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_sne_reg(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    if (cpu->chip8_vregs[in->x] != cpu->chip8_vregs[in->y]) cpu->chip8_pc += 2;
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_ld_i(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_ir = in->nnn;
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_rnd(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_vregs[in->x] = chip8_op_random(cpu, in->kk);
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_drw(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    return chip8_op_draw(cpu, in->x, in->y, in->n);
+}
+
+static inline Chip8_Status chip8_exec_skp(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    if (cpu->chip8_key_state[cpu->chip8_vregs[in->x] & 0XF]) cpu->chip8_pc += 2;
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_ld_vx_dt(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_vregs[in->x] = cpu->chip8_d_timer;
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_ld_key(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    chip8_op_wait_key(cpu, in->x);
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_ld_dt(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_d_timer = cpu->chip8_vregs[in->x];
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_ld_st(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_s_timer = cpu->chip8_vregs[in->x];
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_add_i(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_ir += cpu->chip8_vregs[in->x];
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_ld_f(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    cpu->chip8_ir = cpu->chip8_vregs[in->x];
+    return CHIP8_OK;
+}
+
+static inline Chip8_Status chip8_exec_ld_bcd(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    return chip8_op_bcd(cpu, in->x);
+}
+
+static inline Chip8_Status chip8_exec_ld_store(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    return chip8_op_store(cpu, in->x);
+}
+
+static inline Chip8_Status chip8_exec_ld_load(Chip8_CPU *cpu, const Chip8_Instr *in)
+{
+    return chip8_op_load(cpu, in->x);
+}
+
+// X-macro over every op the decoder produces: X(Chip8_Op, chip8_exec_ suffix)
+#define CHIP8_FOREACH_OP(X)                  \
+    X(CHIP8_OP_UNKNOWN,   unknown)           \
+    X(CHIP8_OP_END,       end)               \
+    X(CHIP8_OP_CLS,       cls)               \
+    X(CHIP8_OP_RET,       ret)               \
+    X(CHIP8_OP_JP,        jp)                \
+    X(CHIP8_OP_CALL,      call)              \
+    X(CHIP8_OP_SE_BYTE,   se_byte)           \
+    X(CHIP8_OP_SNE_BYTE,  sne_byte)          \
+    X(CHIP8_OP_LD_BYTE,   ld_byte)           \
+    X(CHIP8_OP_ADD_BYTE,  add_byte)          \
+    X(CHIP8_OP_LD_REG,    ld_reg)            \
+    X(CHIP8_OP_OR,        or)                \
+    X(CHIP8_OP_AND,       and)               \
+    X(CHIP8_OP_XOR,       xor)               \
+    X(CHIP8_OP_ADD_REG,   add_reg)           \
+    X(CHIP8_OP_SUB,       sub)               \
+    X(CHIP8_OP_SHR,       shr)               \
+    X(CHIP8_OP_SUBN,      subn)              \
+    X(CHIP8_OP_SHL,       shl)               \
+    X(CHIP8_OP_SNE_REG,   sne_reg)           \
+    X(CHIP8_OP_LD_I,      ld_i)              \
+    X(CHIP8_OP_RND,       rnd)               \
+    X(CHIP8_OP_DRW,       drw)               \
+    X(CHIP8_OP_SKP,       skp)               \
+    X(CHIP8_OP_LD_VX_DT,  ld_vx_dt)          \
+    X(CHIP8_OP_LD_KEY,    ld_key)            \
+    X(CHIP8_OP_LD_DT,     ld_dt)             \
+    X(CHIP8_OP_LD_ST,     ld_st)             \
+    X(CHIP8_OP_ADD_I,     add_i)             \
+    X(CHIP8_OP_LD_F,      ld_f)              \
+    X(CHIP8_OP_LD_BCD,    ld_bcd)            \
+    X(CHIP8_OP_LD_STORE,  ld_store)          \
+    X(CHIP8_OP_LD_LOAD,   ld_load)
+
+#endif // CHIP8_OPS_H
@@ -0,0 +1,167 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+
+// Runtime profiler and tracer. Instructions go through chip8_execute_opcode one at a time so every
+// one of them is seen, which costs the speed of the engines. None of this runs unless
+// cpu->chip8_profile or cpu->chip8_tracer is set.
+
+static const char *chip8_op_names[CHIP8_OP_COUNT] = {
+    [CHIP8_OP_UNDECODED] = "????",
+    [CHIP8_OP_UNKNOWN]   = "???? unknown",
+    [CHIP8_OP_END]       = "---- end of program",
+    [CHIP8_OP_CLS]       = "00E0 CLS",
+    [CHIP8_OP_RET]       = "00EE RET",
+    [CHIP8_OP_JP]        = "1NNN JP addr",
+    [CHIP8_OP_CALL]      = "2NNN CALL addr",
+    [CHIP8_OP_SE_BYTE]   = "3XKK SE Vx, byte",
+    [CHIP8_OP_SNE_BYTE]  = "4XKK SNE Vx, byte",
+    [CHIP8_OP_LD_BYTE]   = "6XKK LD Vx, byte",
+    [CHIP8_OP_ADD_BYTE]  = "7XKK ADD Vx, byte",
+    [CHIP8_OP_LD_REG]    = "8XY0 LD Vx, Vy",
+    [CHIP8_OP_OR]        = "8XY1 OR Vx, Vy",
+    [CHIP8_OP_AND]       = "8XY2 AND Vx, Vy",
+    [CHIP8_OP_XOR]       = "8XY3 XOR Vx, Vy",
+    [CHIP8_OP_ADD_REG]   = "8XY4 ADD Vx, Vy",
+    [CHIP8_OP_SUB]       = "8XY5 SUB Vx, Vy",
+    [CHIP8_OP_SHR]       = "8XY6 SHR Vx",
+    [CHIP8_OP_SUBN]      = "8XY7 SUBN Vx, Vy",
+    [CHIP8_OP_SHL]       = "8XYE SHL Vx",
+    [CHIP8_OP_SNE_REG]   = "9XY0 SNE Vx, Vy",
+    [CHIP8_OP_LD_I]      = "ANNN LD I, addr",
+    [CHIP8_OP_RND]       = "CXKK RND Vx, byte",
+    [CHIP8_OP_DRW]       = "DXYN DRW Vx, Vy, n",
+    [CHIP8_OP_SKP]       = "EX9E SKP Vx",
+    [CHIP8_OP_LD_VX_DT]  = "FX07 LD Vx, DT",
+    [CHIP8_OP_LD_KEY]    = "FX0A LD Vx, K",
+    [CHIP8_OP_LD_DT]     = "FX15 LD DT, Vx",
+    [CHIP8_OP_LD_ST]     = "FX18 LD ST, Vx",
+    [CHIP8_OP_ADD_I]     = "FX1E ADD I, Vx",
+    [CHIP8_OP_LD_F]      = "FX29 LD F, Vx",
+    [CHIP8_OP_LD_BCD]    = "FX33 LD B, Vx",
+    [CHIP8_OP_LD_STORE]  = "FX55 LD [I], Vx",
+    [CHIP8_OP_LD_LOAD]   = "FX65 LD Vx, [I]",
+};
+
+const char *chip8_op_name(Chip8_Op op)
+{
+    if (op < CHIP8_OP_COUNT) return chip8_op_names[op];
+    return "Invalid Op";
+}
+
+static uint8_t chip8_popcount8(uint8_t byte)
+{
+    uint8_t count = 0;
+    for (; byte != 0; byte &= byte - 1) count++;
+    return count;
+}
+
+Chip8_Status chip8_run_instrumented(Chip8_CPU *cpu, uint64_t n)
+{
+    Chip8_Profile *profile = cpu->chip8_profile;
+    Chip8_Tracer  *tracer  = cpu->chip8_tracer;
+    for (uint64_t i = 0; i < n; ++i) {
+        uint16_t pc = cpu->chip8_pc;
+        uint16_t opcode = 0;
+        Chip8_Instr instr = {0};
+        if (pc >= CHIP8_PROGRAM_ENTRY + cpu->chip8_rom_size || pc + 1 >= CHIP8_RAM_CAP) {
+            instr.op = CHIP8_OP_END;
+        } else {
+            opcode = (cpu->chip8_memory[pc] << 8) | cpu->chip8_memory[pc + 1];
+            chip8_decode(opcode, &instr);
+        }
+
+        // Sprite pixels come from memory at I, which DXYN leaves as it is
+        uint64_t pixels = 0;
+        if (profile != NULL && instr.op == CHIP8_OP_DRW) {
+            for (uint8_t row = 0; row < instr.n; ++row) {
+                pixels += chip8_popcount8(cpu->chip8_memory[(cpu->chip8_ir + row) % CHIP8_RAM_CAP]);
+            }
+        }
+
+        uint8_t before[CHIP8_VREG_COUNT];
+        if (tracer != NULL) memcpy(before, cpu->chip8_vregs, sizeof(before));
+
+        Chip8_Status status = chip8_execute_quirks(cpu);
+
+        // The failing instruction is recorded too, it is the one worth seeing after a fault
+        if (tracer != NULL) {
+            Chip8_Trace_Record *record = &tracer->records[tracer->written++ & (tracer->capacity - 1)];
+            record->cycle   = cpu->chip8_cycles;
+            record->pc      = pc;
+            record->opcode  = opcode;
+            record->ir      = cpu->chip8_ir;
+            record->changed = 0;
+            for (uint8_t x = 0; x < CHIP8_VREG_COUNT; ++x) {
+                if (cpu->chip8_vregs[x] != before[x]) record->changed |= 1u << x;
+            }
+            memcpy(record->vregs, cpu->chip8_vregs, sizeof(record->vregs));
+        }
+        if (status != CHIP8_OK) return status;
+        cpu->chip8_cycles++;
+
+        if (profile != NULL) {
+            profile->op_counts[instr.op]++;
+            profile->pc_counts[pc]++;
+            if (instr.op == CHIP8_OP_DRW) {
+                profile->draw_pixels += pixels;
+                profile->collisions  += cpu->chip8_vregs[0xF];
+            }
+        }
+    }
+    return CHIP8_OK;
+}
+
+typedef struct Chip8_Profile_Entry {
+    uint16_t index;
+    uint64_t count;
+} Chip8_Profile_Entry;
+
+static int chip8_compare_entries(const void *a, const void *b)
+{
+    const Chip8_Profile_Entry *x = a, *y = b;
+    if (x->count != y->count) return x->count < y->count ? 1 : -1;
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+void chip8_profile_report(const Chip8_CPU *cpu, FILE *stream, size_t top)
+{
+    const Chip8_Profile *profile = cpu->chip8_profile;
+    if (profile == NULL) return;
+
+    uint64_t total = 0;
+    for (int op = 0; op < CHIP8_OP_COUNT; ++op) total += profile->op_counts[op];
+    double scale = total > 0 ? 100.0 / (double)total : 0.0;
+
+    fprintf(stream, "[PROFILE] %lu instructions, %lu idle cycles skipped\n",
+            (unsigned long)total, (unsigned long)profile->idle_cycles);
+    fprintf(stream, "[PROFILE] DXYN: %lu draws, %lu pixels, %lu collisions\n",
+            (unsigned long)profile->op_counts[CHIP8_OP_DRW], (unsigned long)profile->draw_pixels,
+            (unsigned long)profile->collisions);
+
+    Chip8_Profile_Entry ops[CHIP8_OP_COUNT];
+    for (int op = 0; op < CHIP8_OP_COUNT; ++op) ops[op] = (Chip8_Profile_Entry){(uint16_t)op, profile->op_counts[op]};
+    qsort(ops, CHIP8_OP_COUNT, sizeof(ops[0]), chip8_compare_entries);
+
+    fprintf(stream, "[PROFILE] By op class:\n");
+    for (int i = 0; i < CHIP8_OP_COUNT && ops[i].count > 0; ++i) {
+        fprintf(stream, "    %-22s %12lu  %6.2f%%\n",
+                chip8_op_names[ops[i].index], (unsigned long)ops[i].count, (double)ops[i].count * scale);
+    }
+
+    static Chip8_Profile_Entry pcs[CHIP8_RAM_CAP];
+    for (int pc = 0; pc < CHIP8_RAM_CAP; ++pc) pcs[pc] = (Chip8_Profile_Entry){(uint16_t)pc, profile->pc_counts[pc]};
+    qsort(pcs, CHIP8_RAM_CAP, sizeof(pcs[0]), chip8_compare_entries);
+
+    fprintf(stream, "[PROFILE] Hottest addresses:\n");
+    for (size_t i = 0; i < top && i < CHIP8_RAM_CAP && pcs[i].count > 0; ++i) {
+        uint16_t pc = pcs[i].index;
+        uint16_t opcode = (cpu->chip8_memory[pc] << 8) | (pc + 1 < CHIP8_RAM_CAP ? cpu->chip8_memory[pc + 1] : 0);
+        fprintf(stream, "    0X%03X  %04X  %12lu  %6.2f%%\n",
+                pc, opcode, (unsigned long)pcs[i].count, (double)pcs[i].count * scale);
+    }
+}
@@ -0,0 +1,104 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "chip8.h"
+
+// One interpreter per quirk profile, each an instance of chip8_quirks.h with its quirks fixed at
+// compile time. The profile is looked up once per chip8_run_quirks call, never per instruction.
+// CHIP8_QUIRKS_LEGACY has no instance here, it runs on the engines.
+
+#define CHIP8_MEMORY_PAST_LAST 0 /* FX55/FX65 leave I at I + X + 1 */
+#define CHIP8_MEMORY_ON_LAST   1 /* FX55/FX65 leave I at I + X */
+#define CHIP8_MEMORY_KEEP      2 /* FX55/FX65 leave I as it was */
+
+#define CHIP8_QUIRK_PASTE_(a, b) a##b
+#define CHIP8_QUIRK_PASTE(a, b)  CHIP8_QUIRK_PASTE_(a, b)
+
+#define CHIP8_QUIRK_NAME     vip
+#define CHIP8_QUIRK_VF_RESET 1
+#define CHIP8_QUIRK_SHIFT_VY 1
+#define CHIP8_QUIRK_MEMORY   CHIP8_MEMORY_PAST_LAST
+#define CHIP8_QUIRK_JUMP_VX  0
+#define CHIP8_QUIRK_CLIP     1
+#include "chip8_quirks.h"
+
+#define CHIP8_QUIRK_NAME     chip48
+#define CHIP8_QUIRK_VF_RESET 0
+#define CHIP8_QUIRK_SHIFT_VY 0
+#define CHIP8_QUIRK_MEMORY   CHIP8_MEMORY_ON_LAST
+#define CHIP8_QUIRK_JUMP_VX  1
+#define CHIP8_QUIRK_CLIP     1
+#include "chip8_quirks.h"
+
+#define CHIP8_QUIRK_NAME     schip
+#define CHIP8_QUIRK_VF_RESET 0
+#define CHIP8_QUIRK_SHIFT_VY 0
+#define CHIP8_QUIRK_MEMORY   CHIP8_MEMORY_KEEP
+#define CHIP8_QUIRK_JUMP_VX  1
+#define CHIP8_QUIRK_CLIP     1
+#include "chip8_quirks.h"
+
+#define CHIP8_QUIRK_NAME     xochip
+#define CHIP8_QUIRK_VF_RESET 0
+#define CHIP8_QUIRK_SHIFT_VY 1
+#define CHIP8_QUIRK_MEMORY   CHIP8_MEMORY_PAST_LAST
+#define CHIP8_QUIRK_JUMP_VX  0
+#define CHIP8_QUIRK_CLIP     0
+#include "chip8_quirks.h"
+
+static const char *chip8_quirks_names[CHIP8_QUIRKS_COUNT] = {
+    [CHIP8_QUIRKS_LEGACY] = "legacy",
+    [CHIP8_QUIRKS_VIP]    = "vip",
+    [CHIP8_QUIRKS_CHIP48] = "chip48",
+    [CHIP8_QUIRKS_SCHIP]  = "schip",
+    [CHIP8_QUIRKS_XOCHIP] = "xochip",
+};
+
+const char *chip8_quirks_name(Chip8_Quirks quirks)
+{
+    if (quirks < CHIP8_QUIRKS_COUNT) return chip8_quirks_names[quirks];
+    return "invalid";
+}
+
+bool chip8_parse_quirks(const char *name, Chip8_Quirks *quirks)
+{
+    for (int i = 0; i < CHIP8_QUIRKS_COUNT; ++i) {
+        if (strcmp(name, chip8_quirks_names[i]) == 0) {
+            *quirks = (Chip8_Quirks)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+Chip8_Status chip8_execute_quirks(Chip8_CPU *cpu)
+{
+    switch (cpu->chip8_quirks) {
+    case CHIP8_QUIRKS_VIP:    return chip8_step_vip(cpu);
+    case CHIP8_QUIRKS_CHIP48: return chip8_step_chip48(cpu);
+    case CHIP8_QUIRKS_SCHIP:  return chip8_step_schip(cpu);
+    case CHIP8_QUIRKS_XOCHIP: return chip8_step_xochip(cpu);
+    case CHIP8_QUIRKS_LEGACY:
+    default:                  return chip8_execute_opcode(cpu);
+    }
+}
+
+Chip8_Status chip8_run_quirks(Chip8_CPU *cpu, uint64_t n)
+{
+    switch (cpu->chip8_quirks) {
+    case CHIP8_QUIRKS_VIP:    return chip8_run_vip(cpu, n);
+    case CHIP8_QUIRKS_CHIP48: return chip8_run_chip48(cpu, n);
+    case CHIP8_QUIRKS_SCHIP:  return chip8_run_schip(cpu, n);
+    case CHIP8_QUIRKS_XOCHIP: return chip8_run_xochip(cpu, n);
+    case CHIP8_QUIRKS_LEGACY:
+    default: {
+        for (uint64_t i = 0; i < n; ++i) {
+            Chip8_Status status = chip8_execute_opcode(cpu);
+            if (status != CHIP8_OK) return status;
+            cpu->chip8_cycles++;
+        }
+        return CHIP8_OK;
+    }
+    }
+}
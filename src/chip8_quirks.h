@@ -0,0 +1,235 @@
+// Interpreter template, included by chip8_quirks.c once per quirk profile with these set:
+//   CHIP8_QUIRK_NAME      suffix of the functions it defines: chip8_step_<name>, chip8_run_<name>
+//   CHIP8_QUIRK_VF_RESET  8XY1/8XY2/8XY3 clear VF
+//   CHIP8_QUIRK_SHIFT_VY  8XY6/8XYE shift Vy into Vx rather than Vx in place
+//   CHIP8_QUIRK_MEMORY    where FX55/FX65 leave I, one of the CHIP8_MEMORY_* values
+//   CHIP8_QUIRK_JUMP_VX   BXNN jumps to XNN + VX rather than NNN + V0
+//   CHIP8_QUIRK_CLIP      DXYN clips sprites at the screen edges rather than wrapping them
+// The settings are constants, so every quirk is decided when the instance is compiled.
+// No include guard: it is meant to be included more than once. Internal to libchip8
+
+#define CHIP8_QUIRK_FN(prefix) CHIP8_QUIRK_PASTE(prefix, CHIP8_QUIRK_NAME)
+
+static Chip8_Status CHIP8_QUIRK_FN(chip8_draw_)(Chip8_CPU *cpu, uint8_t vidx_x, uint8_t vidx_y, uint8_t n_bytes)
+{
+    // The start position always wraps, only the pixels past the edge are clipped
+    unsigned x = cpu->chip8_vregs[vidx_x] % CHIP8_DW;
+    unsigned y = cpu->chip8_vregs[vidx_y] % CHIP8_DH;
+
+    cpu->chip8_draws++;
+    cpu->chip8_display_dirty = true;
+    cpu->chip8_vregs[0XF] = 0;
+    for (uint8_t i = 0; i < n_bytes; ++i) {
+        if (CHIP8_QUIRK_CLIP && y + i >= CHIP8_DH) break;
+
+        uint8_t sprite_byte = 0;
+        if (!chip8_read_memory(cpu, cpu->chip8_ir + i, &sprite_byte)) return CHIP8_OUT_OF_BOUNDS;
+
+        uint64_t sprite = (uint64_t)sprite_byte << (CHIP8_DW - 8);
+        if (CHIP8_QUIRK_CLIP) {
+            sprite >>= x;
+        } else if (x) {
+            sprite = (sprite >> x) | (sprite << (CHIP8_DW - x));
+        }
+
+        uint64_t *row = &cpu->chip8_frame_buffer[(y + i) % CHIP8_DH];
+        if (*row & sprite) cpu->chip8_vregs[0XF] = 1;
+        *row ^= sprite;
+    }
+    return CHIP8_OK;
+}
+
+static Chip8_Status CHIP8_QUIRK_FN(chip8_memory_)(Chip8_CPU *cpu, uint8_t v_index, bool store)
+{
+    for (uint8_t i = 0; i <= v_index; ++i) {
+        uint16_t loc = cpu->chip8_ir + i;
+        bool ok = store ? chip8_write_memory(cpu, loc, cpu->chip8_vregs[i])
+                        : chip8_read_memory(cpu, loc, &cpu->chip8_vregs[i]);
+        if (!ok) return CHIP8_OUT_OF_BOUNDS;
+    }
+    if (CHIP8_QUIRK_MEMORY == CHIP8_MEMORY_PAST_LAST) cpu->chip8_ir += v_index + 1;
+    if (CHIP8_QUIRK_MEMORY == CHIP8_MEMORY_ON_LAST)   cpu->chip8_ir += v_index;
+    return CHIP8_OK;
+}
+
+static Chip8_Status CHIP8_QUIRK_FN(chip8_step_)(Chip8_CPU *cpu)
+{
+    if (cpu->chip8_pc >= CHIP8_PROGRAM_ENTRY + cpu->chip8_rom_size) return CHIP8_FINISHED;
+    if (cpu->chip8_pc + 1 >= CHIP8_RAM_CAP) return CHIP8_OUT_OF_BOUNDS;
+
+    uint16_t opcode = (uint16_t)(cpu->chip8_memory[cpu->chip8_pc] << 8 | cpu->chip8_memory[cpu->chip8_pc + 1]);
+    uint8_t *v   = cpu->chip8_vregs;
+    uint8_t  x   = (opcode >> 8) & 0XF;
+    uint8_t  y   = (opcode >> 4) & 0XF;
+    uint8_t  kk  = opcode & 0XFF;
+    uint16_t nnn = opcode & 0XFFF;
+
+    cpu->chip8_pc += 2;
+    switch (opcode >> 12) {
+    case 0X0:
+        if (opcode == 0X00E0) {
+            chip8_clear_display(cpu);
+            return CHIP8_OK;
+        }
+        if (opcode == 0X00EE) return chip8_op_return(cpu);
+        return CHIP8_UNKNOWN_OPCODE;
+
+    case 0X1:
+        cpu->chip8_pc = nnn;
+        return CHIP8_OK;
+
+    case 0X2:
+        return chip8_op_call(cpu, nnn);
+
+    case 0X3:
+        if (v[x] == kk) cpu->chip8_pc += 2;
+        return CHIP8_OK;
+
+    case 0X4:
+        if (v[x] != kk) cpu->chip8_pc += 2;
+        return CHIP8_OK;
+
+    case 0X5:
+        if ((opcode & 0XF) != 0) return CHIP8_UNKNOWN_OPCODE;
+        if (v[x] == v[y]) cpu->chip8_pc += 2;
+        return CHIP8_OK;
+
+    case 0X6:
+        v[x] = kk;
+        return CHIP8_OK;
+
+    case 0X7:
+        v[x] += kk;
+        return CHIP8_OK;
+
+    case 0X8: {
+        // The flag is written last, so it wins when x is F
+        uint8_t flag = 0;
+        switch (opcode & 0XF) {
+        case 0X0:
+            v[x] = v[y];
+            return CHIP8_OK;
+        case 0X1:
+            v[x] |= v[y];
+            if (CHIP8_QUIRK_VF_RESET) v[0XF] = 0;
+            return CHIP8_OK;
+        case 0X2:
+            v[x] &= v[y];
+            if (CHIP8_QUIRK_VF_RESET) v[0XF] = 0;
+            return CHIP8_OK;
+        case 0X3:
+            v[x] ^= v[y];
+            if (CHIP8_QUIRK_VF_RESET) v[0XF] = 0;
+            return CHIP8_OK;
+        case 0X4:
+            flag = (uint16_t)v[x] + v[y] > UINT8_MAX;
+            v[x] += v[y];
+            break;
+        case 0X5:
+            flag = v[x] >= v[y];
+            v[x] -= v[y];
+            break;
+        case 0X6: {
+            uint8_t source = CHIP8_QUIRK_SHIFT_VY ? v[y] : v[x];
+            flag = source & 0X01;
+            v[x] = source >> 1;
+            break;
+        }
+        case 0X7:
+            flag = v[y] >= v[x];
+            v[x] = v[y] - v[x];
+            break;
+        case 0XE: {
+            uint8_t source = CHIP8_QUIRK_SHIFT_VY ? v[y] : v[x];
+            flag = source >> 7;
+            v[x] = (uint8_t)(source << 1);
+            break;
+        }
+        default:
+            return CHIP8_UNKNOWN_OPCODE;
+        }
+        v[0XF] = flag;
+        return CHIP8_OK;
+    }
+
+    case 0X9:
+        if ((opcode & 0XF) != 0) return CHIP8_UNKNOWN_OPCODE;
+        if (v[x] != v[y]) cpu->chip8_pc += 2;
+        return CHIP8_OK;
+
+    case 0XA:
+        cpu->chip8_ir = nnn;
+        return CHIP8_OK;
+
+    case 0XB:
+        cpu->chip8_pc = nnn + (CHIP8_QUIRK_JUMP_VX ? v[x] : v[0]);
+        return CHIP8_OK;
+
+    case 0XC:
+        v[x] = chip8_op_random(cpu, kk);
+        return CHIP8_OK;
+
+    case 0XD:
+        return CHIP8_QUIRK_FN(chip8_draw_)(cpu, x, y, opcode & 0XF);
+
+    case 0XE:
+        if (kk == 0X9E) {
+            if (cpu->chip8_key_state[v[x] & 0XF]) cpu->chip8_pc += 2;
+            return CHIP8_OK;
+        }
+        if (kk == 0XA1) {
+            if (!cpu->chip8_key_state[v[x] & 0XF]) cpu->chip8_pc += 2;
+            return CHIP8_OK;
+        }
+        return CHIP8_UNKNOWN_OPCODE;
+
+    case 0XF:
+        switch (kk) {
+        case 0X07:
+            v[x] = cpu->chip8_d_timer;
+            return CHIP8_OK;
+        case 0X0A:
+            chip8_op_wait_key(cpu, x);
+            return CHIP8_OK;
+        case 0X15:
+            cpu->chip8_d_timer = v[x];
+            return CHIP8_OK;
+        case 0X18:
+            cpu->chip8_s_timer = v[x];
+            return CHIP8_OK;
+        case 0X1E:
+            cpu->chip8_ir += v[x];
+            return CHIP8_OK;
+        case 0X29:
+            cpu->chip8_ir = (v[x] & 0XF) * CHIP8_FONT_HEIGHT;
+            return CHIP8_OK;
+        case 0X33:
+            return chip8_op_bcd(cpu, x);
+        case 0X55:
+            return CHIP8_QUIRK_FN(chip8_memory_)(cpu, x, true);
+        case 0X65:
+            return CHIP8_QUIRK_FN(chip8_memory_)(cpu, x, false);
+        default:
+            return CHIP8_UNKNOWN_OPCODE;
+        }
+    }
+    return CHIP8_UNKNOWN_OPCODE;
+}
+
+static Chip8_Status CHIP8_QUIRK_FN(chip8_run_)(Chip8_CPU *cpu, uint64_t n)
+{
+    for (uint64_t i = 0; i < n; ++i) {
+        Chip8_Status status = CHIP8_QUIRK_FN(chip8_step_)(cpu);
+        if (status != CHIP8_OK) return status;
+        cpu->chip8_cycles++;
+    }
+    return CHIP8_OK;
+}
+
+#undef CHIP8_QUIRK_FN
+#undef CHIP8_QUIRK_NAME
+#undef CHIP8_QUIRK_VF_RESET
+#undef CHIP8_QUIRK_SHIFT_VY
+#undef CHIP8_QUIRK_MEMORY
+#undef CHIP8_QUIRK_JUMP_VX
+#undef CHIP8_QUIRK_CLIP
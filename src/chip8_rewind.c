@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+
+// An encoded frame is a sequence of runs: skip:u16 length:u16 bytes[length], in host byte order.
+// `skip` bytes are unchanged, then `length` bytes are XORed in. Between two frames most of the
+// state is unchanged, so a delta is usually a few dozen bytes. A keyframe is the same encoding
+// against an all-zero state.
+
+// A new run costs its 4 byte header, shorter gaps of unchanged bytes are stored inside the run
+#define CHIP8_REWIND_RUN_GAP 4
+
+// Every byte changed with a run header every CHIP8_REWIND_RUN_GAP + 1 bytes
+#define CHIP8_REWIND_MAX_ENTRY (2 * sizeof(Chip8_Rewind_State) + 4)
+
+typedef char chip8_rewind_state_fits_runs[sizeof(Chip8_Rewind_State) <= UINT16_MAX ? 1 : -1];
+
+static const Chip8_Rewind_State chip8_rewind_zero;
+
+bool chip8_rewind_init(Chip8_Rewind *rewind, size_t frames, size_t bytes)
+{
+    memset(rewind, 0, sizeof(Chip8_Rewind));
+    if (bytes < CHIP8_REWIND_MAX_ENTRY) bytes = CHIP8_REWIND_MAX_ENTRY;
+
+    rewind->entries = calloc(frames, sizeof(Chip8_Rewind_Entry));
+    rewind->data    = malloc(bytes);
+    if (rewind->entries == NULL || rewind->data == NULL) {
+        fprintf(stderr, "[ERROR] Memory Allocation for %zu Rewind Frames Failed\n", frames);
+        chip8_rewind_free(rewind);
+        return false;
+    }
+    rewind->capacity  = frames;
+    rewind->data_size = bytes;
+    return true;
+}
+
+void chip8_rewind_free(Chip8_Rewind *rewind)
+{
+    free(rewind->entries);
+    free(rewind->data);
+    memset(rewind, 0, sizeof(Chip8_Rewind));
+}
+
+static Chip8_Rewind_Entry *chip8_rewind_entry(Chip8_Rewind *rewind, size_t index)
+{
+    return &rewind->entries[(rewind->first + index) % rewind->capacity];
+}
+
+static void chip8_rewind_drop_oldest(Chip8_Rewind *rewind)
+{
+    rewind->first = (rewind->first + 1) % rewind->capacity;
+    rewind->count--;
+}
+
+static void chip8_rewind_capture(Chip8_Rewind_State *state, const Chip8_CPU *cpu)
+{
+    // Field by field, the padding of `state` stays zero and never shows up in a delta
+    memcpy(state->memory, cpu->chip8_memory, sizeof(state->memory));
+    memcpy(state->frame_buffer, cpu->chip8_frame_buffer, sizeof(state->frame_buffer));
+    state->cycles  = cpu->chip8_cycles;
+    state->draws   = cpu->chip8_draws;
+    state->rng     = cpu->chip8_rng;
+    state->ir      = cpu->chip8_ir;
+    state->pc      = cpu->chip8_pc;
+    memcpy(state->vregs, cpu->chip8_vregs, sizeof(state->vregs));
+    state->d_timer = cpu->chip8_d_timer;
+    state->s_timer = cpu->chip8_s_timer;
+    state->stack   = cpu->chip8_stack;
+}
+
+static size_t chip8_rewind_encode(const uint8_t *now, const uint8_t *before, size_t size, uint8_t *out)
+{
+    size_t written = 0;
+    size_t i = 0;
+    while (i < size) {
+        // Skip the unchanged bytes, a word at a time
+        size_t start = i;
+        for (;;) {
+            uint64_t a, b;
+            if (i + 8 > size) break;
+            memcpy(&a, &now[i], 8);
+            memcpy(&b, &before[i], 8);
+            if (a != b) break;
+            i += 8;
+        }
+        while (i < size && now[i] == before[i]) i++;
+        if (i == size) break;
+
+        // Extend the run up to its last changed byte, bridging gaps shorter than a run header
+        size_t last = i;
+        for (size_t j = i + 1; j < size && j - last <= CHIP8_REWIND_RUN_GAP; ++j) {
+            if (now[j] != before[j]) last = j;
+        }
+        uint16_t skip   = (uint16_t)(i - start);
+        uint16_t length = (uint16_t)(last + 1 - i);
+        memcpy(&out[written], &skip, 2);
+        memcpy(&out[written + 2], &length, 2);
+        written += 4;
+        for (size_t k = 0; k < length; ++k) out[written + k] = now[i + k] ^ before[i + k];
+        written += length;
+        i = last + 1;
+    }
+    return written;
+}
+
+// XOR an encoded frame into `state`
+static void chip8_rewind_apply(uint8_t *state, const uint8_t *in, size_t size)
+{
+    size_t pos = 0;
+    size_t i   = 0;
+    while (i < size) {
+        uint16_t skip, length;
+        memcpy(&skip, &in[i], 2);
+        memcpy(&length, &in[i + 2], 2);
+        i   += 4;
+        pos += skip;
+        for (size_t k = 0; k < length; ++k) state[pos + k] ^= in[i + k];
+        pos += length;
+        i   += length;
+    }
+}
+
+static void chip8_rewind_decode(Chip8_Rewind *rewind, Chip8_Rewind_State *state, size_t index)
+{
+    const Chip8_Rewind_Entry *entry = chip8_rewind_entry(rewind, index);
+    if (entry->key) memset(state, 0, sizeof(Chip8_Rewind_State));
+    chip8_rewind_apply((uint8_t*)state, &rewind->data[entry->offset], entry->size);
+}
+
+void chip8_rewind_push(Chip8_Rewind *rewind, const Chip8_CPU *cpu)
+{
+    if (rewind->capacity == 0) return;
+    if (rewind->count == rewind->capacity) chip8_rewind_drop_oldest(rewind);
+    if (rewind->count == 0) rewind->data_end = 0;
+
+    // Make room for the largest possible frame after data_end, wrapping to the start if needed.
+    // Live frames run from the oldest to data_end, wrapping around the end of the byte ring
+    size_t at = rewind->data_end;
+    if (at + CHIP8_REWIND_MAX_ENTRY > rewind->data_size) {
+        while (rewind->count > 0 && chip8_rewind_entry(rewind, 0)->offset >= at) chip8_rewind_drop_oldest(rewind);
+        at = 0;
+    }
+    while (rewind->count > 0) {
+        const Chip8_Rewind_Entry *oldest = chip8_rewind_entry(rewind, 0);
+        if (oldest->offset >= at + CHIP8_REWIND_MAX_ENTRY || oldest->offset + oldest->size <= at) break;
+        chip8_rewind_drop_oldest(rewind);
+    }
+
+    // The first frame kept has to be a keyframe, there is nothing before it to XOR against
+    bool key = rewind->count == 0 || rewind->since_key + 1 >= CHIP8_REWIND_KEY_INTERVAL;
+    chip8_rewind_capture(&rewind->scratch, cpu);
+    const Chip8_Rewind_State *before = key ? &chip8_rewind_zero : &rewind->current;
+    size_t size = chip8_rewind_encode((const uint8_t*)&rewind->scratch, (const uint8_t*)before,
+                                      sizeof(Chip8_Rewind_State), &rewind->data[at]);
+
+    Chip8_Rewind_Entry *entry = chip8_rewind_entry(rewind, rewind->count++);
+    entry->offset = (uint32_t)at;
+    entry->size   = (uint32_t)size;
+    entry->key    = key;
+    rewind->data_end  = at + size;
+    rewind->since_key = key ? 0 : rewind->since_key + 1;
+    rewind->current   = rewind->scratch;
+}
+
+bool chip8_rewind_pop(Chip8_Rewind *rewind, Chip8_CPU *cpu)
+{
+    if (rewind->count < 2) return false;
+
+    size_t newest = rewind->count - 1;
+    const Chip8_Rewind_Entry *entry = chip8_rewind_entry(rewind, newest);
+    if (!entry->key) {
+        // XOR is its own inverse, the delta takes the newest state back to the one before it
+        chip8_rewind_apply((uint8_t*)&rewind->current, &rewind->data[entry->offset], entry->size);
+    } else {
+        // Rebuild the frame before a keyframe forward from the keyframe before that
+        size_t key = newest;
+        while (key > 0 && !chip8_rewind_entry(rewind, key - 1)->key) key--;
+        if (key == 0) return false;
+        key--;
+        for (size_t i = key; i < newest; ++i) chip8_rewind_decode(rewind, &rewind->current, i);
+    }
+    rewind->data_end = entry->offset;
+    rewind->count--;
+
+    rewind->since_key = 0;
+    while (rewind->since_key + 1 < rewind->count && !chip8_rewind_entry(rewind, newest - 1 - rewind->since_key)->key) {
+        rewind->since_key++;
+    }
+
+    const Chip8_Rewind_State *state = &rewind->current;
+    chip8_restore_memory(cpu, state->memory);
+    memcpy(cpu->chip8_frame_buffer, state->frame_buffer, sizeof(cpu->chip8_frame_buffer));
+    cpu->chip8_cycles  = state->cycles;
+    cpu->chip8_draws   = state->draws;
+    cpu->chip8_rng     = state->rng;
+    cpu->chip8_ir      = state->ir;
+    cpu->chip8_pc      = state->pc;
+    memcpy(cpu->chip8_vregs, state->vregs, sizeof(cpu->chip8_vregs));
+    cpu->chip8_d_timer = state->d_timer;
+    cpu->chip8_s_timer = state->s_timer;
+    cpu->chip8_stack   = state->stack;
+    cpu->chip8_display_dirty = true;
+    cpu->chip8_idle          = false;
+    return true;
+}
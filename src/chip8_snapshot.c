@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#include "chip8.h"
+
+// Snapshot layout, every field little-endian:
+//
+//   magic[4] version:u16 rom_size:u16 rom_hash:u32
+//   vregs[16] ir:u16 pc:u16 d_timer:u8 s_timer:u8
+//   stack_count:u8 stack_slots[stack_count]
+//   cycles:u64 draws:u64 rng:u32 frame_buffer:u64[CHIP8_DH]
+//   run_count:u16, then run_count times { offset:u16 length:u16 bytes[length] }
+//
+// rom_hash is Chip8_CPU.chip8_rom_hash. The runs hold the RAM bytes that differ from
+// chip8_base_memory. Most programs only touch a few variables, so a snapshot is usually a few
+// hundred bytes, most of them the frame buffer.
+
+// A new run costs its 4 byte header, shorter gaps of unchanged bytes are stored inside the run
+#define CHIP8_SNAPSHOT_RUN_GAP 4
+
+typedef struct Chip8_Snapshot_Writer {
+    uint8_t *data;
+    size_t   cap;
+    size_t   size; // Keeps counting past cap so the caller learns it didn't fit
+} Chip8_Snapshot_Writer;
+
+typedef struct Chip8_Snapshot_Reader {
+    const uint8_t *data;
+    size_t         size;
+    size_t         pos;
+    bool           ok; // Cleared by a read past the end
+} Chip8_Snapshot_Reader;
+
+static void chip8_put_bytes(Chip8_Snapshot_Writer *w, const uint8_t *bytes, size_t count)
+{
+    if (w->size + count <= w->cap) memcpy(&w->data[w->size], bytes, count);
+    w->size += count;
+}
+
+static void chip8_put_le(Chip8_Snapshot_Writer *w, uint64_t value, int bytes)
+{
+    uint8_t buffer[8];
+    for (int i = 0; i < bytes; ++i) buffer[i] = (value >> (8 * i)) & 0xFF;
+    chip8_put_bytes(w, buffer, bytes);
+}
+
+static const uint8_t *chip8_get_bytes(Chip8_Snapshot_Reader *r, size_t count)
+{
+    if (!r->ok || count > r->size - r->pos) {
+        r->ok = false;
+        return NULL;
+    }
+    const uint8_t *bytes = &r->data[r->pos];
+    r->pos += count;
+    return bytes;
+}
+
+static uint64_t chip8_get_le(Chip8_Snapshot_Reader *r, int bytes)
+{
+    const uint8_t *buffer = chip8_get_bytes(r, bytes);
+    if (buffer == NULL) return 0;
+
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) value |= (uint64_t)buffer[i] << (8 * i);
+    return value;
+}
+
+size_t chip8_snapshot_save(const Chip8_CPU *cpu, uint8_t *data, size_t cap)
+{
+    Chip8_Snapshot_Writer w = { .data = data, .cap = cap, .size = 0 };
+
+    chip8_put_bytes(&w, (const uint8_t*)CHIP8_SNAPSHOT_MAGIC, 4);
+    chip8_put_le(&w, CHIP8_SNAPSHOT_VERSION, 2);
+    chip8_put_le(&w, cpu->chip8_rom_size, 2);
+    chip8_put_le(&w, cpu->chip8_rom_hash, 4);
+
+    chip8_put_bytes(&w, cpu->chip8_vregs, CHIP8_VREG_COUNT);
+    chip8_put_le(&w, cpu->chip8_ir, 2);
+    chip8_put_le(&w, cpu->chip8_pc, 2);
+    chip8_put_le(&w, cpu->chip8_d_timer, 1);
+    chip8_put_le(&w, cpu->chip8_s_timer, 1);
+    chip8_put_le(&w, cpu->chip8_stack.count, 1);
+    chip8_put_bytes(&w, cpu->chip8_stack.slots, cpu->chip8_stack.count);
+    chip8_put_le(&w, cpu->chip8_cycles, 8);
+    chip8_put_le(&w, cpu->chip8_draws, 8);
+    chip8_put_le(&w, cpu->chip8_rng, 4);
+    for (int j = 0; j < CHIP8_DH; ++j) chip8_put_le(&w, cpu->chip8_frame_buffer[j], 8);
+
+    // The run count goes in front of the runs, patch it in once they are written
+    size_t count_at = w.size;
+    uint16_t runs = 0;
+    chip8_put_le(&w, 0, 2);
+
+    const uint8_t *mem  = cpu->chip8_memory;
+    const uint8_t *base = cpu->chip8_base_memory;
+    size_t i = 0;
+    while (i < CHIP8_RAM_CAP) {
+        if (mem[i] == base[i]) {
+            i++;
+            continue;
+        }
+
+        // Extend the run up to its last changed byte, bridging gaps shorter than a run header
+        size_t start = i;
+        size_t last  = i;
+        for (size_t j = i + 1; j < CHIP8_RAM_CAP && j - last <= CHIP8_SNAPSHOT_RUN_GAP; ++j) {
+            if (mem[j] != base[j]) last = j;
+        }
+        size_t length = last + 1 - start;
+        chip8_put_le(&w, start, 2);
+        chip8_put_le(&w, length, 2);
+        chip8_put_bytes(&w, &mem[start], length);
+        runs++;
+        i = last + 1;
+    }
+
+    if (w.size > cap) return 0;
+    data[count_at]     = runs & 0xFF;
+    data[count_at + 1] = runs >> 8;
+    return w.size;
+}
+
+bool chip8_snapshot_load(Chip8_CPU *cpu, const uint8_t *data, size_t size)
+{
+    Chip8_Snapshot_Reader r = { .data = data, .size = size, .pos = 0, .ok = true };
+
+    const uint8_t *magic = chip8_get_bytes(&r, 4);
+    if (magic == NULL || memcmp(magic, CHIP8_SNAPSHOT_MAGIC, 4) != 0) {
+        fprintf(stderr, "[ERROR] Not a CHIP-8 snapshot\n");
+        return false;
+    }
+    uint16_t version = (uint16_t)chip8_get_le(&r, 2);
+    if (version != CHIP8_SNAPSHOT_VERSION) {
+        fprintf(stderr, "[ERROR] Unsupported snapshot version %u\n", version);
+        return false;
+    }
+    uint16_t rom_size = (uint16_t)chip8_get_le(&r, 2);
+    uint32_t rom_hash = (uint32_t)chip8_get_le(&r, 4);
+    if (r.ok && (rom_size != cpu->chip8_rom_size || rom_hash != cpu->chip8_rom_hash)) {
+        fprintf(stderr, "[ERROR] Snapshot was taken with a different program loaded\n");
+        return false;
+    }
+
+    // Decode everything before touching the CPU, a truncated snapshot leaves it as it was
+    uint8_t ram[CHIP8_RAM_CAP];
+    uint64_t frame_buffer[CHIP8_DH];
+    const uint8_t *vregs = chip8_get_bytes(&r, CHIP8_VREG_COUNT);
+    uint16_t ir       = (uint16_t)chip8_get_le(&r, 2);
+    uint16_t pc       = (uint16_t)chip8_get_le(&r, 2);
+    uint8_t  d_timer  = (uint8_t)chip8_get_le(&r, 1);
+    uint8_t  s_timer  = (uint8_t)chip8_get_le(&r, 1);
+    uint8_t  sp       = (uint8_t)chip8_get_le(&r, 1);
+    if (sp > CHIP8_STACK_CAP) r.ok = false;
+    const uint8_t *slots = chip8_get_bytes(&r, r.ok ? sp : 0);
+    uint64_t cycles   = chip8_get_le(&r, 8);
+    uint64_t draws    = chip8_get_le(&r, 8);
+    uint32_t rng      = (uint32_t)chip8_get_le(&r, 4);
+    for (int j = 0; j < CHIP8_DH; ++j) frame_buffer[j] = chip8_get_le(&r, 8);
+
+    memcpy(ram, cpu->chip8_base_memory, sizeof(ram));
+    uint16_t runs = (uint16_t)chip8_get_le(&r, 2);
+    for (uint16_t k = 0; k < runs && r.ok; ++k) {
+        uint16_t offset = (uint16_t)chip8_get_le(&r, 2);
+        uint16_t length = (uint16_t)chip8_get_le(&r, 2);
+        const uint8_t *bytes = chip8_get_bytes(&r, length);
+        if (bytes == NULL || offset + length > CHIP8_RAM_CAP) r.ok = false;
+        else memcpy(&ram[offset], bytes, length);
+    }
+    if (!r.ok || r.pos != size || rng == 0) {
+        fprintf(stderr, "[ERROR] Snapshot is truncated or corrupt\n");
+        return false;
+    }
+
+    memcpy(cpu->chip8_vregs, vregs, CHIP8_VREG_COUNT);
+    cpu->chip8_ir      = ir;
+    cpu->chip8_pc      = pc;
+    cpu->chip8_d_timer = d_timer;
+    cpu->chip8_s_timer = s_timer;
+    cpu->chip8_stack.count = sp;
+    memcpy(cpu->chip8_stack.slots, slots, sp);
+    cpu->chip8_cycles  = cycles;
+    cpu->chip8_draws   = draws;
+    cpu->chip8_rng     = rng;
+    memcpy(cpu->chip8_frame_buffer, frame_buffer, sizeof(cpu->chip8_frame_buffer));
+
+    chip8_restore_memory(cpu, ram);
+    cpu->chip8_display_dirty = true;
+    cpu->chip8_idle          = false;
+    return true;
+}
+
+bool chip8_snapshot_write_file(const Chip8_CPU *cpu, const char *path)
+{
+    uint8_t data[CHIP8_SNAPSHOT_MAX_SIZE];
+    size_t size = chip8_snapshot_save(cpu, data, sizeof(data));
+
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "[ERROR] Could not write `%s`: `%s`\n", path, strerror(errno));
+        return false;
+    }
+    bool ok = fwrite(data, 1, size, fp) == size;
+    if (fclose(fp) != 0) ok = false;
+    if (!ok) fprintf(stderr, "[ERROR] Could not write `%s`: `%s`\n", path, strerror(errno));
+    return ok;
+}
+
+bool chip8_snapshot_read_file(Chip8_CPU *cpu, const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "[ERROR] Could not read `%s`: `%s`\n", path, strerror(errno));
+        return false;
+    }
+
+    // One byte of slack tells an oversized file from one that fills the buffer exactly
+    uint8_t data[CHIP8_SNAPSHOT_MAX_SIZE + 1];
+    size_t size = fread(data, 1, sizeof(data), fp);
+    fclose(fp);
+    if (size > CHIP8_SNAPSHOT_MAX_SIZE) {
+        fprintf(stderr, "[ERROR] `%s` is too large for a snapshot\n", path);
+        return false;
+    }
+    return chip8_snapshot_load(cpu, data, size);
+}
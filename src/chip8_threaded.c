@@ -0,0 +1,141 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "chip8.h"
+#include "chip8_ops.h"
+
+// Threaded dispatch over the decode cache.
+// Every op body ends with its own fetch and indirect jump to the next op, so there is no shared
+// dispatch branch, no function call per instruction, and no bounds check on PC: entries past the
+// end of the program decode to CHIP8_OP_END. Only ops that set PC to an arbitrary value check
+// for an odd or out of range PC, which takes the reference path.
+//
+// GCC and Clang use computed goto. Other compilers get the same bodies under a switch in a loop.
+
+#ifndef CHIP8_COMPUTED_GOTO
+#if defined(__GNUC__) || defined(__clang__)
+#define CHIP8_COMPUTED_GOTO 1
+#else
+#define CHIP8_COMPUTED_GOTO 0
+#endif
+#endif
+
+#define CHIP8_FETCH()                                                      \
+    do {                                                                   \
+        if (remaining == 0) goto done;                                     \
+        remaining--;                                                       \
+        instr = &cpu->chip8_decoded[cpu->chip8_pc >> 1];                   \
+        if (instr->handler == NULL) chip8_decode_at(cpu, cpu->chip8_pc);   \
+        cpu->chip8_pc += 2;                                                \
+    } while (0)
+
+#if CHIP8_COMPUTED_GOTO
+#define CHIP8_NEXT()                                                       \
+    do {                                                                   \
+        CHIP8_FETCH();                                                     \
+        goto *chip8_labels[instr->op];                                     \
+    } while (0)
+#define CHIP8_TARGET(op) target_##op:
+#else
+#define CHIP8_NEXT()     continue
+#define CHIP8_TARGET(op) case op:
+#endif
+
+// Run an op body, leave on failure, otherwise move on to the next instruction
+#define CHIP8_EXEC(op, name)                                               \
+    CHIP8_TARGET(op) {                                                     \
+        status = chip8_exec_##name(cpu, instr);                            \
+        if (status != CHIP8_OK) goto done;                                 \
+        CHIP8_NEXT();                                                      \
+    }
+
+// Same as CHIP8_EXEC for ops that load PC from an operand or the stack
+#define CHIP8_EXEC_JUMP(op, name)                                          \
+    CHIP8_TARGET(op) {                                                     \
+        status = chip8_exec_##name(cpu, instr);                            \
+        if (status != CHIP8_OK) goto done;                                 \
+        if ((cpu->chip8_pc & 1) || cpu->chip8_pc >= CHIP8_RAM_CAP) goto slow; \
+        CHIP8_NEXT();                                                      \
+    }
+
+Chip8_Status chip8_run_threaded(Chip8_CPU *cpu, uint64_t n)
+{
+    uint64_t remaining = n;
+    Chip8_Status status = CHIP8_OK;
+    const Chip8_Instr *instr = NULL;
+
+#if CHIP8_COMPUTED_GOTO
+    static void *chip8_labels[CHIP8_OP_COUNT] = {
+        [CHIP8_OP_UNDECODED] = &&target_CHIP8_OP_UNKNOWN,
+#define CHIP8_LABEL_ENTRY(op, name) [op] = &&target_##op,
+        CHIP8_FOREACH_OP(CHIP8_LABEL_ENTRY)
+#undef CHIP8_LABEL_ENTRY
+    };
+#endif
+
+    // A caller may hand over any PC, only enter the threaded code from a cacheable one
+    if ((cpu->chip8_pc & 1) || cpu->chip8_pc >= CHIP8_RAM_CAP) goto slow;
+
+resume:
+#if CHIP8_COMPUTED_GOTO
+    CHIP8_NEXT();
+    {
+#else
+    for (;;) {
+        CHIP8_FETCH();
+        switch (instr->op) {
+        default:
+#endif
+        CHIP8_EXEC(CHIP8_OP_UNKNOWN,   unknown)
+        CHIP8_EXEC(CHIP8_OP_END,       end)
+        CHIP8_EXEC(CHIP8_OP_CLS,       cls)
+        CHIP8_EXEC_JUMP(CHIP8_OP_RET,  ret)
+        CHIP8_EXEC_JUMP(CHIP8_OP_JP,   jp)
+        CHIP8_EXEC_JUMP(CHIP8_OP_CALL, call)
+        CHIP8_EXEC(CHIP8_OP_SE_BYTE,   se_byte)
+        CHIP8_EXEC(CHIP8_OP_SNE_BYTE,  sne_byte)
+        CHIP8_EXEC(CHIP8_OP_LD_BYTE,   ld_byte)
+        CHIP8_EXEC(CHIP8_OP_ADD_BYTE,  add_byte)
+        CHIP8_EXEC(CHIP8_OP_LD_REG,    ld_reg)
+        CHIP8_EXEC(CHIP8_OP_OR,        or)
+        CHIP8_EXEC(CHIP8_OP_AND,       and)
+        CHIP8_EXEC(CHIP8_OP_XOR,       xor)
+        CHIP8_EXEC(CHIP8_OP_ADD_REG,   add_reg)
+        CHIP8_EXEC(CHIP8_OP_SUB,       sub)
+        CHIP8_EXEC(CHIP8_OP_SHR,       shr)
+        CHIP8_EXEC(CHIP8_OP_SUBN,      subn)
+        CHIP8_EXEC(CHIP8_OP_SHL,       shl)
+        CHIP8_EXEC(CHIP8_OP_SNE_REG,   sne_reg)
+        CHIP8_EXEC(CHIP8_OP_LD_I,      ld_i)
+        CHIP8_EXEC(CHIP8_OP_RND,       rnd)
+        CHIP8_EXEC(CHIP8_OP_DRW,       drw)
+        CHIP8_EXEC(CHIP8_OP_SKP,       skp)
+        CHIP8_EXEC(CHIP8_OP_LD_VX_DT,  ld_vx_dt)
+        CHIP8_EXEC(CHIP8_OP_LD_KEY,    ld_key)
+        CHIP8_EXEC(CHIP8_OP_LD_DT,     ld_dt)
+        CHIP8_EXEC(CHIP8_OP_LD_ST,     ld_st)
+        CHIP8_EXEC(CHIP8_OP_ADD_I,     add_i)
+        CHIP8_EXEC(CHIP8_OP_LD_F,      ld_f)
+        CHIP8_EXEC(CHIP8_OP_LD_BCD,    ld_bcd)
+        CHIP8_EXEC(CHIP8_OP_LD_STORE,  ld_store)
+        CHIP8_EXEC(CHIP8_OP_LD_LOAD,   ld_load)
+#if !CHIP8_COMPUTED_GOTO
+        }
+#endif
+    }
+
+slow:
+    // Odd or out of range PC: step through the reference interpreter until PC is cacheable again
+    while ((cpu->chip8_pc & 1) || cpu->chip8_pc >= CHIP8_RAM_CAP) {
+        if (remaining == 0) goto done;
+        remaining--;
+        status = chip8_execute_opcode(cpu);
+        if (status != CHIP8_OK) goto done;
+    }
+    goto resume;
+
+done:
+    // The failing instruction was fetched but does not count as executed
+    cpu->chip8_cycles += n - remaining - (status != CHIP8_OK ? 1 : 0);
+    return status;
+}
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "chip8.h"
+
+// Records are filled by chip8_run_instrumented, this file only owns the ring and writes it out
+
+// The file format promises 32 byte records
+typedef char chip8_trace_record_is_32_bytes[sizeof(Chip8_Trace_Record) == 32 ? 1 : -1];
+
+bool chip8_tracer_init(Chip8_Tracer *tracer, uint64_t capacity)
+{
+    memset(tracer, 0, sizeof(Chip8_Tracer));
+    uint64_t rounded = 1;
+    while (rounded < capacity) rounded <<= 1;
+
+    tracer->records = calloc(rounded, sizeof(Chip8_Trace_Record));
+    if (tracer->records == NULL) {
+        fprintf(stderr, "[ERROR] Memory Allocation for %lu Trace Records Failed\n", (unsigned long)rounded);
+        return false;
+    }
+    tracer->capacity = rounded;
+    return true;
+}
+
+void chip8_tracer_free(Chip8_Tracer *tracer)
+{
+    free(tracer->records);
+    memset(tracer, 0, sizeof(Chip8_Tracer));
+}
+
+bool chip8_tracer_flush(const Chip8_Tracer *tracer, const char *path, Chip8_Status status)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp == NULL) {
+        fprintf(stderr, "[ERROR] Could not write `%s`: `%s`\n", path, strerror(errno));
+        return false;
+    }
+
+    uint64_t count = tracer->written < tracer->capacity ? tracer->written : tracer->capacity;
+    Chip8_Trace_Header header = {0};
+    memcpy(header.magic, CHIP8_TRACE_MAGIC, sizeof(header.magic));
+    header.version     = CHIP8_TRACE_VERSION;
+    header.record_size = sizeof(Chip8_Trace_Record);
+    header.status      = status;
+    header.count       = count;
+    header.overwritten = tracer->written - count;
+
+    // Oldest record first: the ring wraps at `first`
+    uint64_t first = (tracer->written - count) & (tracer->capacity - 1);
+    uint64_t tail  = count < tracer->capacity - first ? count : tracer->capacity - first;
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1
+           && fwrite(&tracer->records[first], sizeof(Chip8_Trace_Record), tail, fp) == tail
+           && fwrite(tracer->records, sizeof(Chip8_Trace_Record), count - tail, fp) == count - tail;
+    if (fclose(fp) != 0) ok = false;
+    if (!ok) fprintf(stderr, "[ERROR] Could not write `%s`: `%s`\n", path, strerror(errno));
+    return ok;
+}
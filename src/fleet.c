@@ -0,0 +1,618 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "chip8.h"
+
+// Runs a list of jobs, each a ROM with its own seed, input movie and budget, on a pool of worker
+// threads. Every job gets a freshly reset CPU, so no state is shared between jobs apart from the
+// ROM images, which are read once and only read from then on.
+//
+// Jobs are dealt out to the workers in contiguous ranges. A worker takes jobs from the front of its
+// own range and, once that is empty, steals from the back of the others', so a few slow jobs don't
+// leave the rest of the pool idle.
+
+#define CHIP8_FLEET_FRAMES    600 /* Default budget of a job without a movie, in 60Hz frames */
+#define CHIP8_FLEET_MAX_LINE  4096
+
+typedef enum Chip8_Fleet_Format {
+    CHIP8_FLEET_TEXT = 0,
+    CHIP8_FLEET_CSV,
+    CHIP8_FLEET_JSON,
+} Chip8_Fleet_Format;
+
+typedef struct Chip8_Fleet_Rom {
+    char    *path;
+    uint8_t *data;
+    size_t   size;
+} Chip8_Fleet_Rom;
+
+typedef struct Chip8_Fleet_Job {
+    size_t       rom;        // Index into Chip8_Fleet.roms
+    uint32_t     seed;       // CXKK seed, 0 selects CHIP8_RNG_SEED. Replaced by a movie's own once it starts
+    char        *movie_path; // NULL to run without input
+    Chip8_Quirks quirks;
+    uint64_t     max_cycles;
+    uint64_t     max_frames;
+
+    // Filled in by the worker that ran the job
+    Chip8_Status status;
+    uint64_t     cycles;
+    uint64_t     frames;
+    uint64_t     draws;
+    uint32_t     screen_hash; // FNV-1a of the final frame buffer
+    double       seconds;
+    double       cpu_seconds; // CPU time of the worker thread, wall time grows when threads outnumber CPUs
+    int          worker;
+    bool         failed;      // The job couldn't start, e.g. its movie didn't match the ROM
+} Chip8_Fleet_Job;
+
+// Jobs [head, tail) still waiting in a worker's range, packed into one word so the owner taking
+// from the front and thieves taking from the back agree through a single compare-and-swap
+typedef struct Chip8_Fleet_Worker {
+    uint64_t   range;  // Atomic, head in the low 32 bits, tail in the high 32 bits
+    uint64_t   steals; // Jobs it took from other workers
+    int        index;
+    pthread_t  thread;
+    struct Chip8_Fleet *fleet;
+} Chip8_Fleet_Worker;
+
+typedef struct Chip8_Fleet {
+    Chip8_Fleet_Rom    *roms;
+    size_t              rom_count;
+    Chip8_Fleet_Job    *jobs;
+    size_t              job_count;
+    size_t              job_capacity;
+    Chip8_Fleet_Worker *workers;
+    int                 worker_count;
+    Chip8_Engine        engine;
+    bool                skip_idle;
+} Chip8_Fleet;
+
+static double chip8_fleet_clock(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static double chip8_fleet_now(void)
+{
+    return chip8_fleet_clock(CLOCK_MONOTONIC);
+}
+
+static uint64_t chip8_fleet_pack(uint32_t head, uint32_t tail)
+{
+    return (uint64_t)head | ((uint64_t)tail << 32);
+}
+
+// Take the next job from the front of the worker's own range
+static bool chip8_fleet_take(Chip8_Fleet_Worker *worker, size_t *job)
+{
+    uint64_t range = __atomic_load_n(&worker->range, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t head = (uint32_t)range;
+        uint32_t tail = (uint32_t)(range >> 32);
+        if (head >= tail) return false;
+        if (__atomic_compare_exchange_n(&worker->range, &range, chip8_fleet_pack(head + 1, tail),
+                                        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *job = head;
+            return true;
+        }
+    }
+}
+
+// Take the last job of another worker's range
+static bool chip8_fleet_steal(Chip8_Fleet_Worker *victim, size_t *job)
+{
+    uint64_t range = __atomic_load_n(&victim->range, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t head = (uint32_t)range;
+        uint32_t tail = (uint32_t)(range >> 32);
+        if (head >= tail) return false;
+        if (__atomic_compare_exchange_n(&victim->range, &range, chip8_fleet_pack(head, tail - 1),
+                                        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *job = tail - 1;
+            return true;
+        }
+    }
+}
+
+static uint32_t chip8_fleet_screen_hash(const Chip8_CPU *cpu)
+{
+    uint32_t hash = 2166136261u;
+    for (int y = 0; y < CHIP8_DH; ++y) {
+        for (int i = 0; i < 8; ++i) {
+            hash ^= (cpu->chip8_frame_buffer[y] >> (8 * i)) & 0xFF;
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+// Run one job to its budget. The timers tick every 700/60 cycles as in a headless run, and the
+// runs stop at every key change of the movie so the CPU sees it at the recorded cycle
+static void chip8_fleet_run_job(const Chip8_Fleet *fleet, Chip8_Fleet_Job *job, Chip8_CPU *cpu)
+{
+    const Chip8_Fleet_Rom *rom = &fleet->roms[job->rom];
+    double start     = chip8_fleet_now();
+    double cpu_start = chip8_fleet_clock(CLOCK_THREAD_CPUTIME_ID);
+
+    chip8_reset(cpu);
+    cpu->chip8_engine    = fleet->engine;
+    cpu->chip8_skip_idle = fleet->skip_idle;
+    cpu->chip8_quirks    = job->quirks;
+    if (!chip8_load_rom(cpu, rom->data, rom->size)) {
+        job->failed = true;
+        return;
+    }
+    chip8_seed_random(cpu, job->seed);
+
+    Chip8_Movie movie = {0};
+    bool playing = job->movie_path != NULL;
+    if (playing && (!chip8_movie_read(&movie, job->movie_path) || !chip8_movie_start(&movie, cpu))) {
+        chip8_movie_free(&movie);
+        job->failed = true;
+        return;
+    }
+    if (playing) job->seed = movie.rng;
+
+    uint64_t max_cycles = job->max_cycles;
+    uint64_t max_frames = job->max_frames;
+    if (max_cycles == UINT64_MAX && max_frames == UINT64_MAX) {
+        if (playing) max_cycles = movie.end_cycle - movie.start_cycle;
+        else max_frames = CHIP8_FLEET_FRAMES;
+    }
+
+    Chip8_Status status = CHIP8_OK;
+    uint64_t frames = 0;
+    while (status == CHIP8_OK && frames < max_frames && cpu->chip8_cycles < max_cycles) {
+        uint64_t tick_at   = (uint64_t)((double)(frames + 1) * CHIP8_CPU_HZ / CHIP8_TIMER_HZ);
+        uint64_t frame_end = tick_at < max_cycles ? tick_at : max_cycles;
+        while (status == CHIP8_OK && cpu->chip8_cycles < frame_end) {
+            uint64_t next = playing ? chip8_movie_play(&movie, cpu) : UINT64_MAX;
+            uint64_t stop = next < frame_end ? next : frame_end;
+            status = chip8_run_cycles(cpu, stop - cpu->chip8_cycles);
+        }
+        if (cpu->chip8_cycles < tick_at) break;
+        chip8_tick_timers(cpu);
+        frames++;
+    }
+    chip8_movie_free(&movie);
+
+    job->status      = status;
+    job->cycles      = cpu->chip8_cycles;
+    job->frames      = frames;
+    job->draws       = cpu->chip8_draws;
+    job->screen_hash = chip8_fleet_screen_hash(cpu);
+    job->seconds     = chip8_fleet_now() - start;
+    job->cpu_seconds = chip8_fleet_clock(CLOCK_THREAD_CPUTIME_ID) - cpu_start;
+}
+
+static void *chip8_fleet_worker(void *data)
+{
+    Chip8_Fleet_Worker *worker = data;
+    Chip8_Fleet *fleet = worker->fleet;
+
+    // One CPU per worker, reset at the start of every job
+    Chip8_CPU *cpu = malloc(sizeof(Chip8_CPU));
+    if (cpu == NULL) {
+        fprintf(stderr, "[ERROR] Memory Allocation for Worker %d Failed\n", worker->index);
+        return NULL;
+    }
+
+    for (;;) {
+        size_t job;
+        if (!chip8_fleet_take(worker, &job)) {
+            // Start with the next worker so thieves spread out over their victims
+            bool stolen = false;
+            for (int i = 1; i < fleet->worker_count && !stolen; ++i) {
+                stolen = chip8_fleet_steal(&fleet->workers[(worker->index + i) % fleet->worker_count], &job);
+            }
+            // Ranges only ever shrink, once none has a job left there is nothing more to do
+            if (!stolen) break;
+            worker->steals++;
+        }
+        fleet->jobs[job].worker = worker->index;
+        chip8_fleet_run_job(fleet, &fleet->jobs[job], cpu);
+    }
+
+    free(cpu);
+    chip8_jit_release();
+    return NULL;
+}
+
+static bool chip8_fleet_parse_u64(const char *what, const char *value, uint64_t *out)
+{
+    char *end = NULL;
+    errno = 0;
+    *out = strtoull(value, &end, 0);
+    if (errno != 0 || *value == '\0' || *end != '\0') {
+        fprintf(stderr, "[ERROR] Invalid %s `%s`\n", what, value);
+        return false;
+    }
+    return true;
+}
+
+static char *chip8_fleet_strdup(const char *s)
+{
+    size_t size = strlen(s) + 1;
+    char *copy = malloc(size);
+    if (copy != NULL) memcpy(copy, s, size);
+    return copy;
+}
+
+// ROM images are read once per path and shared read-only by every job that runs them
+static bool chip8_fleet_find_rom(Chip8_Fleet *fleet, const char *path, size_t *index)
+{
+    for (size_t i = 0; i < fleet->rom_count; ++i) {
+        if (strcmp(fleet->roms[i].path, path) == 0) {
+            *index = i;
+            return true;
+        }
+    }
+
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "[ERROR] Could not read `%s`: `%s`\n", path, strerror(errno));
+        return false;
+    }
+    uint8_t *data = malloc(CHIP8_RAM_CAP);
+    size_t size = data != NULL ? fread(data, 1, CHIP8_RAM_CAP, fp) : 0;
+    fclose(fp);
+    if (data == NULL || size == 0 || size > CHIP8_RAM_CAP - CHIP8_PROGRAM_ENTRY) {
+        fprintf(stderr, "[ERROR] `%s` is not a CHIP-8 program that fits in RAM\n", path);
+        free(data);
+        return false;
+    }
+
+    Chip8_Fleet_Rom *roms = realloc(fleet->roms, (fleet->rom_count + 1) * sizeof(Chip8_Fleet_Rom));
+    if (roms == NULL) {
+        free(data);
+        return false;
+    }
+    fleet->roms = roms;
+    roms[fleet->rom_count].path = chip8_fleet_strdup(path);
+    roms[fleet->rom_count].data = data;
+    roms[fleet->rom_count].size = size;
+    *index = fleet->rom_count++;
+    return roms[*index].path != NULL;
+}
+
+static Chip8_Fleet_Job *chip8_fleet_add_job(Chip8_Fleet *fleet)
+{
+    if (fleet->job_count == fleet->job_capacity) {
+        size_t capacity = fleet->job_capacity > 0 ? fleet->job_capacity * 2 : 64;
+        Chip8_Fleet_Job *jobs = realloc(fleet->jobs, capacity * sizeof(Chip8_Fleet_Job));
+        if (jobs == NULL) {
+            fprintf(stderr, "[ERROR] Memory Allocation for %zu Jobs Failed\n", capacity);
+            return NULL;
+        }
+        fleet->jobs = jobs;
+        fleet->job_capacity = capacity;
+    }
+    Chip8_Fleet_Job *job = &fleet->jobs[fleet->job_count++];
+    memset(job, 0, sizeof(*job));
+    return job;
+}
+
+// One job per line: <rom> [seed=<n>] [movie=<path>] [cycles=<n>] [frames=<n>] [quirks=<profile>]
+// Blank lines and lines starting with # are skipped. Every line runs `repeat` times, with the
+// seed counting up from the one given
+static bool chip8_fleet_read_jobs(Chip8_Fleet *fleet, const char *path, uint64_t repeat)
+{
+    FILE *fp = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "[ERROR] Could not read `%s`: `%s`\n", path, strerror(errno));
+        return false;
+    }
+
+    char line[CHIP8_FLEET_MAX_LINE];
+    size_t line_number = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), fp) != NULL) {
+        line_number++;
+        char *save = NULL;
+        char *rom_path = strtok_r(line, " \t\r\n", &save);
+        if (rom_path == NULL || rom_path[0] == '#') continue;
+
+        Chip8_Fleet_Job job = { .max_cycles = UINT64_MAX, .max_frames = UINT64_MAX };
+        uint64_t seed = 0;
+        bool seeded = false;
+        ok = chip8_fleet_find_rom(fleet, rom_path, &job.rom);
+        for (char *field = strtok_r(NULL, " \t\r\n", &save); ok && field != NULL; field = strtok_r(NULL, " \t\r\n", &save)) {
+            if (strncmp(field, "seed=", 5) == 0) {
+                ok = chip8_fleet_parse_u64("seed", field + 5, &seed);
+                seeded = true;
+            } else if (strncmp(field, "cycles=", 7) == 0) {
+                ok = chip8_fleet_parse_u64("cycle count", field + 7, &job.max_cycles);
+            } else if (strncmp(field, "frames=", 7) == 0) {
+                ok = chip8_fleet_parse_u64("frame count", field + 7, &job.max_frames);
+            } else if (strncmp(field, "quirks=", 7) == 0) {
+                ok = chip8_parse_quirks(field + 7, &job.quirks);
+                if (!ok) fprintf(stderr, "[ERROR] Unknown quirk profile `%s`\n", field + 7);
+            } else if (strncmp(field, "movie=", 6) == 0) {
+                job.movie_path = chip8_fleet_strdup(field + 6);
+                ok = job.movie_path != NULL;
+            } else {
+                fprintf(stderr, "[ERROR] Unknown field `%s`\n", field);
+                ok = false;
+            }
+        }
+
+        // A movie replays with the seed it was recorded with
+        if (ok && seeded && job.movie_path != NULL) {
+            fprintf(stderr, "[ERROR] `seed=` can't be combined with `movie=`, the movie brings its own seed\n");
+            ok = false;
+        }
+
+        for (uint64_t i = 0; ok && i < repeat; ++i) {
+            Chip8_Fleet_Job *copy = chip8_fleet_add_job(fleet);
+            if (copy == NULL) {
+                ok = false;
+                break;
+            }
+            *copy = job;
+            copy->seed = (uint32_t)(seed + i);
+            // The repeats share the path, only the first copy owns it
+            if (i > 0) copy->movie_path = job.movie_path != NULL ? chip8_fleet_strdup(job.movie_path) : NULL;
+        }
+        if (!ok) fprintf(stderr, "[ERROR] In `%s` line %zu\n", path, line_number);
+    }
+
+    if (fp != stdin) fclose(fp);
+    if (ok && fleet->job_count == 0) {
+        fprintf(stderr, "[ERROR] `%s` has no jobs\n", path);
+        ok = false;
+    }
+    if (ok && fleet->job_count > UINT32_MAX) {
+        fprintf(stderr, "[ERROR] Too many jobs in `%s`\n", path);
+        ok = false;
+    }
+    return ok;
+}
+
+static void chip8_fleet_free(Chip8_Fleet *fleet)
+{
+    for (size_t i = 0; i < fleet->rom_count; ++i) {
+        free(fleet->roms[i].path);
+        free(fleet->roms[i].data);
+    }
+    for (size_t i = 0; i < fleet->job_count; ++i) free(fleet->jobs[i].movie_path);
+    free(fleet->roms);
+    free(fleet->jobs);
+    free(fleet->workers);
+    memset(fleet, 0, sizeof(*fleet));
+}
+
+static const char *chip8_fleet_status(const Chip8_Fleet_Job *job)
+{
+    return job->failed ? "FAILED" : chip8_status_name(job->status);
+}
+
+// Print `s` as a JSON string, quotes included
+static void chip8_fleet_print_json_string(const char *s)
+{
+    putchar('"');
+    for (; *s != '\0'; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') printf("\\%c", c);
+        else if (c < 0x20) printf("\\u%04x", c);
+        else putchar(c);
+    }
+    putchar('"');
+}
+
+static void chip8_fleet_print_header(Chip8_Fleet_Format format)
+{
+    switch (format) {
+    case CHIP8_FLEET_TEXT:
+        printf("%6s %-36s %10s %-7s %-20s %12s %8s %10s %10s %8s %6s\n",
+               "Job", "ROM", "Seed", "Quirks", "Status", "Cycles", "Frames", "Draws", "Screen", "ms", "Worker");
+        break;
+    case CHIP8_FLEET_CSV:
+        printf("job,rom,seed,quirks,movie,status,cycles,frames,draws,screen_hash,seconds,worker\n");
+        break;
+    case CHIP8_FLEET_JSON:
+        printf("[\n");
+        break;
+    }
+}
+
+static void chip8_fleet_print_job(Chip8_Fleet_Format format, const Chip8_Fleet *fleet, size_t index)
+{
+    const Chip8_Fleet_Job *job = &fleet->jobs[index];
+    const char *rom = fleet->roms[job->rom].path;
+    const char *movie = job->movie_path != NULL ? job->movie_path : "";
+    const char *quirks = chip8_quirks_name(job->quirks);
+
+    switch (format) {
+    case CHIP8_FLEET_TEXT:
+        printf("%6zu %-36s %10lu %-7s %-20s %12lu %8lu %10lu   %08x %8.2f %6d\n",
+               index, rom, (unsigned long)job->seed, quirks, chip8_fleet_status(job), (unsigned long)job->cycles,
+               (unsigned long)job->frames, (unsigned long)job->draws, job->screen_hash, job->seconds * 1e3, job->worker);
+        break;
+    case CHIP8_FLEET_CSV:
+        printf("%zu,%s,%lu,%s,%s,%s,%lu,%lu,%lu,%08x,%.6f,%d\n",
+               index, rom, (unsigned long)job->seed, quirks, movie, chip8_fleet_status(job), (unsigned long)job->cycles,
+               (unsigned long)job->frames, (unsigned long)job->draws, job->screen_hash, job->seconds, job->worker);
+        break;
+    case CHIP8_FLEET_JSON:
+        printf("%s  {\"job\": %zu, \"rom\": ", index == 0 ? "" : ",\n", index);
+        chip8_fleet_print_json_string(rom);
+        printf(", \"seed\": %lu, \"quirks\": \"%s\", \"movie\": ", (unsigned long)job->seed, quirks);
+        chip8_fleet_print_json_string(movie);
+        printf(", \"status\": \"%s\", \"cycles\": %lu, \"frames\": %lu, \"draws\": %lu, \"screen_hash\": \"%08x\", "
+               "\"seconds\": %.6f, \"worker\": %d}",
+               chip8_fleet_status(job), (unsigned long)job->cycles, (unsigned long)job->frames, (unsigned long)job->draws,
+               job->screen_hash, job->seconds, job->worker);
+        break;
+    }
+}
+
+// Totals over every job, per status, and how the work spread over the pool
+static void chip8_fleet_print_summary(Chip8_Fleet_Format format, const Chip8_Fleet *fleet, double wall)
+{
+    uint64_t cycles = 0;
+    uint64_t draws  = 0;
+    uint64_t steals = 0;
+    uint64_t failed = 0;
+    uint64_t statuses[CHIP8_STATUS_COUNT] = {0};
+    double   busy = 0.0;
+    double   cpu  = 0.0;
+    for (size_t i = 0; i < fleet->job_count; ++i) {
+        const Chip8_Fleet_Job *job = &fleet->jobs[i];
+        cycles += job->cycles;
+        draws  += job->draws;
+        busy   += job->seconds;
+        cpu    += job->cpu_seconds;
+        if (job->failed) failed++;
+        else statuses[job->status]++;
+    }
+    for (int i = 0; i < fleet->worker_count; ++i) steals += fleet->workers[i].steals;
+
+    double ips = wall > 0.0 ? (double)cycles / wall : 0.0;
+    if (format == CHIP8_FLEET_JSON) {
+        printf("\n]\n");
+        return;
+    }
+    if (format == CHIP8_FLEET_CSV) return;
+
+    printf("%6s %-36s %10s %-7s %-20s %12lu %8s %10lu %10s %8.2f\n",
+           "", "TOTAL", "", "", "", (unsigned long)cycles, "", (unsigned long)draws, "", busy * 1e3);
+    printf("[INFO] %zu jobs on %d threads in %.3fs, %.0f instructions/sec, %.2fx parallel, %lu stolen\n",
+           fleet->job_count, fleet->worker_count, wall, ips, wall > 0.0 ? cpu / wall : 0.0, (unsigned long)steals);
+    printf("[INFO]");
+    for (int i = 0; i < CHIP8_STATUS_COUNT; ++i) {
+        if (statuses[i] > 0) printf(" %s: %lu", chip8_status_name((Chip8_Status)i), (unsigned long)statuses[i]);
+    }
+    if (failed > 0) printf(" FAILED: %lu", (unsigned long)failed);
+    printf("\n");
+}
+
+static void chip8_fleet_usage(const char *program_name)
+{
+    fprintf(stderr, "[Usage] %s [--threads <n>] [--repeat <n>] [--engine <name>] [--no-idle-skip] [--csv | --json] <jobs>\n", program_name);
+    fprintf(stderr, "    <jobs>              Job list, `-` for stdin. One job per line:\n");
+    fprintf(stderr, "                        <rom> [seed=<n>] [movie=<path>] [cycles=<n>] [frames=<n>] [quirks=<profile>]\n");
+    fprintf(stderr, "                        Without a limit a job runs its movie to the end, or %d frames\n", CHIP8_FLEET_FRAMES);
+    fprintf(stderr, "    --threads <n>       Worker threads (default: one per online CPU)\n");
+    fprintf(stderr, "    --repeat <n>        Run every line <n> times, the seed counting up from its own\n");
+    fprintf(stderr, "    --engine <name>     Interpreter engine:");
+    for (int i = 0; i < CHIP8_ENGINE_COUNT; ++i) fprintf(stderr, " %s", chip8_engine_name((Chip8_Engine)i));
+    fprintf(stderr, "\n");
+    fprintf(stderr, "    --no-idle-skip      Execute idle loops instead of fast-forwarding through them\n");
+    fprintf(stderr, "    --csv, --json       Machine-readable output\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *program_name = argv[0];
+    Chip8_Fleet_Format format = CHIP8_FLEET_TEXT;
+    uint64_t threads = 0;
+    uint64_t repeat  = 1;
+    const char *jobs_path = NULL;
+
+    static Chip8_Fleet fleet = {0};
+    fleet.engine    = CHIP8_ENGINE_CACHED;
+    fleet.skip_idle = true;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (strcmp(arg, "--csv") == 0) {
+            format = CHIP8_FLEET_CSV;
+        } else if (strcmp(arg, "--json") == 0) {
+            format = CHIP8_FLEET_JSON;
+        } else if (strcmp(arg, "--no-idle-skip") == 0) {
+            fleet.skip_idle = false;
+        } else if (strcmp(arg, "--engine") == 0 && i + 1 < argc) {
+            if (!chip8_parse_engine(argv[++i], &fleet.engine)) {
+                fprintf(stderr, "[ERROR] Unknown engine `%s`\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(arg, "--threads") == 0 && i + 1 < argc) {
+            if (!chip8_fleet_parse_u64("thread count", argv[++i], &threads)) return 1;
+            if (threads == 0 || threads > 1024) {
+                fprintf(stderr, "[ERROR] `%s` takes 1 to 1024\n", arg);
+                return 1;
+            }
+        } else if (strcmp(arg, "--repeat") == 0 && i + 1 < argc) {
+            if (!chip8_fleet_parse_u64("repeat count", argv[++i], &repeat)) return 1;
+            if (repeat == 0) {
+                fprintf(stderr, "[ERROR] `%s` must be at least 1\n", arg);
+                return 1;
+            }
+        } else if (jobs_path == NULL && (strncmp(arg, "--", 2) != 0 || strcmp(arg, "-") == 0)) {
+            jobs_path = arg;
+        } else {
+            chip8_fleet_usage(program_name);
+            return 1;
+        }
+    }
+
+    if (jobs_path == NULL) {
+        chip8_fleet_usage(program_name);
+        return 1;
+    }
+    if (!chip8_fleet_read_jobs(&fleet, jobs_path, repeat)) {
+        chip8_fleet_free(&fleet);
+        return 1;
+    }
+
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (uint64_t)online : 1;
+    }
+    if (threads > fleet.job_count) threads = fleet.job_count;
+
+    fleet.worker_count = (int)threads;
+    fleet.workers = calloc(threads, sizeof(Chip8_Fleet_Worker));
+    if (fleet.workers == NULL) {
+        fprintf(stderr, "[ERROR] Memory Allocation for %lu Workers Failed\n", (unsigned long)threads);
+        chip8_fleet_free(&fleet);
+        return 1;
+    }
+    for (int w = 0; w < fleet.worker_count; ++w) {
+        uint32_t head = (uint32_t)(fleet.job_count * w / fleet.worker_count);
+        uint32_t tail = (uint32_t)(fleet.job_count * (w + 1) / fleet.worker_count);
+        fleet.workers[w].range = chip8_fleet_pack(head, tail);
+        fleet.workers[w].index = w;
+        fleet.workers[w].fleet = &fleet;
+    }
+
+    double start = chip8_fleet_now();
+    int started = 0;
+    for (; started < fleet.worker_count; ++started) {
+        int err = pthread_create(&fleet.workers[started].thread, NULL, chip8_fleet_worker, &fleet.workers[started]);
+        if (err != 0) {
+            // The workers already running steal the jobs of the ones that never started
+            fprintf(stderr, "[ERROR] Could not start worker %d: `%s`\n", started, strerror(err));
+            if (started == 0) {
+                chip8_fleet_free(&fleet);
+                return 1;
+            }
+            break;
+        }
+    }
+    for (int w = 0; w < started; ++w) pthread_join(fleet.workers[w].thread, NULL);
+    double wall = chip8_fleet_now() - start;
+
+    chip8_fleet_print_header(format);
+    for (size_t i = 0; i < fleet.job_count; ++i) chip8_fleet_print_job(format, &fleet, i);
+    chip8_fleet_print_summary(format, &fleet, wall);
+
+    // Regression runs only see the exit status, so any job that didn't end OK fails the run
+    bool ok = true;
+    for (size_t i = 0; i < fleet.job_count; ++i) {
+        if (fleet.jobs[i].failed || fleet.jobs[i].status != CHIP8_OK) ok = false;
+    }
+    chip8_fleet_free(&fleet);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,1242 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+/* Build with -DCHIP8_NO_SDL=1 for a headless-only binary that does not link SDL2 */
+#ifndef CHIP8_NO_SDL
+#define CHIP8_NO_SDL 0
+#endif
+
+#if !CHIP8_NO_SDL
+#include <SDL2/SDL.h>
+#endif
+
+#include "chip8.h"
+
+#define CHIP8_WINDOW_WIDTH  640*2    /* SDL Window Width */
+#define CHIP8_WINDOW_HEIGHT 320*2    /* SDL Window Height */
+
+#define CHIP8_DEBUG_RENDER 0
+
+#define CHIP8_REFRESH_RATE 60 /* Fallback when the display doesn't report its refresh rate */
+
+#define CHIP8_MAX_CATCHUP_MS 100 /* Default longest stall replayed instead of dropped */
+
+#define CHIP8_TURBO_KEY   SDLK_TAB /* Held for unthrottled fast-forward */
+#define CHIP8_TURBO_SLICE 10000    /* Cycles run between clock checks in turbo mode */
+#define CHIP8_TURBO_BURST_MS 4     /* Turbo time between frame and key handoffs */
+
+#define CHIP8_PROFILE_TOP 20 /* Addresses listed in the --profile report */
+
+#define CHIP8_TRACE_SIZE  (1u << 20) /* Default instructions kept by --trace, 32MB */
+#define CHIP8_TRACE_KEY   SDLK_F12   /* Write the trace while running */
+
+#define CHIP8_SAVE_KEY   SDLK_F5 /* Quick-save to the --save-state file */
+#define CHIP8_LOAD_KEY   SDLK_F9 /* Quick-load from it */
+#define CHIP8_STATE_EXT  ".state" /* Appended to the ROM path when --save-state isn't given */
+
+#define CHIP8_REWIND_KEY     SDLK_BACKSPACE /* Held to run backwards */
+#define CHIP8_REWIND_SECONDS 60             /* Default emulated time kept for rewinding */
+#define CHIP8_REWIND_BYTES_PER_SECOND (64 * 1024) /* Delta budget, most ROMs use a few KB per second */
+
+#define CHIP8_HEADLESS_FRAMES 600 /* Default frames to emulate in headless mode (10 seconds) */
+
+#define CHIP8_SOUND_FREQUENCY  440
+#define CHIP8_SOUND_SAMPLES    44100
+#define CHIP8_SOUND_BUFFER     512  /* Default device buffer in samples, 512 is ~12ms at 44.1kHz */
+#define CHIP8_SOUND_BUFFER_MIN 256
+#define CHIP8_SOUND_BUFFER_MAX 8192
+
+/* Low Volume - 1 Amplitude Produces Loud Beep Sound Harmful for ears */
+#define CHIP8_SOUND_AMPLITUDE (0.01)
+
+// The callback steers the ring's fill towards two device buffers and drops a backlog of four times
+// that, so the ring holds four cushions of the largest buffer --audio-buffer accepts
+#define CHIP8_AUDIO_RING     (4 * 2 * CHIP8_SOUND_BUFFER_MAX) /* Samples between the emulation thread and the callback, power of two */
+#define CHIP8_AUDIO_MAX_SKEW 0.005 /* Largest playback rate correction, as a fraction of the rate */
+
+// Square wave synthesized in emulated time from an integer phase accumulator.
+// Each emulated cycle is worth sample_rate / cycle_rate samples, sounding while ST is non-zero
+typedef struct Chip8_Synth {
+    uint64_t cycle_rate;  // Emulated cycles per second of audio
+    uint32_t sample_rate;
+    int16_t  amplitude;
+    uint32_t phase;       // A full period is 2^32
+    uint32_t phase_step;  // Phase advance per sample
+    uint64_t cycles;      // Cycle count synthesized up to
+    uint64_t remainder;   // Partial sample, in cycles * sample_rate
+    uint64_t pending;     // Samples owed but not rendered yet
+} Chip8_Synth;
+
+void chip8_init_synth(Chip8_Synth *synth, uint32_t sample_rate, uint64_t cycle_rate, uint64_t cycles)
+{
+    memset(synth, 0, sizeof(Chip8_Synth));
+    synth->cycle_rate  = cycle_rate;
+    synth->sample_rate = sample_rate;
+    synth->amplitude   = (int16_t)(CHIP8_SOUND_AMPLITUDE * 32767);
+    synth->phase_step  = (uint32_t)((double)CHIP8_SOUND_FREQUENCY * 4294967296.0 / sample_rate);
+    synth->cycles      = cycles;
+}
+
+// Render up to `cap` of the samples owed for the cycles run until `cycles`, returns how many.
+// Call again with the same count until it returns 0 to drain them
+size_t chip8_synth_render(Chip8_Synth *synth, uint64_t cycles, bool on, int16_t *out, size_t cap)
+{
+    if (cycles > synth->cycles) {
+        synth->remainder += (cycles - synth->cycles) * synth->sample_rate;
+        synth->pending   += synth->remainder / synth->cycle_rate;
+        synth->remainder %= synth->cycle_rate;
+        synth->cycles     = cycles;
+    }
+
+    size_t count = synth->pending < cap ? (size_t)synth->pending : cap;
+    for (size_t i = 0; i < count; ++i) {
+        if (on) {
+            out[i] = synth->phase < 0x80000000u ? synth->amplitude : -synth->amplitude;
+            synth->phase += synth->phase_step;
+        } else {
+            out[i] = 0;
+            synth->phase = 0; // Every beep starts on a rising edge
+        }
+    }
+    synth->pending -= count;
+    return count;
+}
+
+// Forget the cycles run until `cycles` without rendering them
+void chip8_synth_skip(Chip8_Synth *synth, uint64_t cycles)
+{
+    synth->cycles    = cycles;
+    synth->remainder = 0;
+    synth->pending   = 0;
+}
+
+static void chip8_write_le(FILE *fp, uint32_t value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i) fputc((value >> (8 * i)) & 0xFF, fp);
+}
+
+// 16-bit mono PCM header, the sizes are filled in by chip8_wav_finish
+void chip8_wav_begin(FILE *fp, uint32_t sample_rate)
+{
+    fwrite("RIFF", 1, 4, fp);
+    chip8_write_le(fp, 0, 4);
+    fwrite("WAVEfmt ", 1, 8, fp);
+    chip8_write_le(fp, 16, 4);              // fmt chunk size
+    chip8_write_le(fp, 1, 2);               // PCM
+    chip8_write_le(fp, 1, 2);               // Mono
+    chip8_write_le(fp, sample_rate, 4);
+    chip8_write_le(fp, sample_rate * 2, 4); // Bytes per second
+    chip8_write_le(fp, 2, 2);               // Bytes per sample
+    chip8_write_le(fp, 16, 2);              // Bits per sample
+    fwrite("data", 1, 4, fp);
+    chip8_write_le(fp, 0, 4);
+}
+
+void chip8_wav_write(FILE *fp, const int16_t *samples, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) chip8_write_le(fp, (uint16_t)samples[i], 2);
+}
+
+bool chip8_wav_finish(FILE *fp, uint64_t samples)
+{
+    uint32_t data_size = (uint32_t)(samples * 2);
+    if (fseek(fp, 4, SEEK_SET) != 0) return false;
+    chip8_write_le(fp, 36 + data_size, 4);
+    if (fseek(fp, 40, SEEK_SET) != 0) return false;
+    chip8_write_le(fp, data_size, 4);
+    return true;
+}
+
+// Timer ticks due by `cycles`, the timers tick every CHIP8_CPU_HZ / CHIP8_TIMER_HZ cycles
+uint64_t chip8_timer_frames_at(uint64_t cycles)
+{
+    uint64_t frames = (uint64_t)((double)cycles * CHIP8_TIMER_HZ / CHIP8_CPU_HZ);
+    // Settle the rounding against the exact tick positions used by the run loops
+    while (frames > 0 && (uint64_t)((double)frames * CHIP8_CPU_HZ / CHIP8_TIMER_HZ) > cycles) frames--;
+    while ((uint64_t)((double)(frames + 1) * CHIP8_CPU_HZ / CHIP8_TIMER_HZ) <= cycles) frames++;
+    return frames;
+}
+
+#if !CHIP8_NO_SDL
+#define CHIP8_SDL_ERROR(error, ret)                                 \
+    do {                                                            \
+        fprintf(stderr, "[ERROR] %s: %s\n", error, SDL_GetError()); \
+        return ret;                                                 \
+    }                                                               \
+    while (0)
+
+// Single producer, single consumer sample queue from the emulation thread to the audio callback
+typedef struct Chip8_Audio_Ring {
+    int16_t  samples[CHIP8_AUDIO_RING];
+    uint32_t head;    // Atomic, advanced by the emulation thread
+    uint32_t tail;    // Atomic, advanced by the audio callback
+    uint64_t dropped; // Samples the emulation thread found no room for
+} Chip8_Audio_Ring;
+
+// Audio callback state. The callback plays back the ring a little faster or slower to keep its
+// fill near `target`, which absorbs the drift between the host and audio device clocks
+typedef struct Chip8_Sound {
+    int               sample_rate;
+    uint16_t          buffer_samples; // Device buffer size
+    uint32_t          target;         // Ring fill the rate control steers towards
+    double            position;       // Fractional read position past the tail
+    bool              primed;         // The ring reached target since the last underrun
+    uint64_t          underruns;      // Callbacks that ran out of samples
+    Chip8_Audio_Ring  ring;
+    SDL_AudioDeviceID dev;
+} Chip8_Sound;
+
+typedef struct Chip8_Color {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+} Chip8_Color;
+
+#define BLACK (Chip8_Color){0,   0,     0, 255}
+#define WHITE (Chip8_Color){255, 255, 255, 255}
+#define RED   (Chip8_Color){255, 0,     0, 255}
+#define GREEN (Chip8_Color){0,   255,   0, 255}
+#define BLUE  (Chip8_Color){0,   0,   255, 255}
+
+// 64x32 streaming texture scaled to the window, re-uploaded only when the frame buffer changes
+typedef struct Chip8_Display {
+    SDL_Texture *texture;
+    uint32_t     pixels[CHIP8_DH][CHIP8_DW]; // ARGB8888 staging buffer
+    uint64_t     shown[CHIP8_DH];            // Frame buffer held by the texture
+    bool         uploaded;
+} Chip8_Display;
+
+// Presents at most once per display refresh. With vsync SDL_RenderPresent waits for the refresh,
+// otherwise the loop sleeps until the next deadline on the performance counter or the next event
+typedef struct Chip8_Frame_Pacer {
+    bool     vsync;
+    uint64_t frequency;  // Performance counter ticks per second
+    uint64_t period;     // Ticks per display refresh
+    uint64_t next_frame; // Counter value of the next refresh
+} Chip8_Frame_Pacer;
+
+// Turns host time on the performance counter into emulated cycles, with the 60Hz timers
+// ticking off the cycle count. A stall longer than max_catchup is dropped rather than replayed
+typedef struct Chip8_Scheduler {
+    uint64_t frequency;      // Performance counter ticks per second
+    uint64_t rate;           // Cycles per second, CHIP8_CPU_HZ times the --speed factor
+    uint64_t last;           // Counter value at the previous update
+    uint64_t remainder;      // Time not yet turned into a cycle, in ticks * rate
+    uint64_t max_catchup;    // Longest interval replayed, in ticks
+    uint64_t late_after;     // Cycles due longer ago than this are late, in ticks
+    uint64_t timer_frames;   // Timer ticks so far
+    uint64_t dropped_cycles; // Cycles never run because a stall exceeded max_catchup
+    uint64_t late_cycles;    // Cycles run more than late_after after they were due
+    uint64_t rewind_to;      // Cycle count rewinding is heading back to
+    Chip8_Synth      *synth; // Optional, fed every cycle run outside of turbo
+    Chip8_Audio_Ring *ring;
+    Chip8_Rewind     *rewind; // Optional, records a frame at every timer tick
+} Chip8_Scheduler;
+
+#define CHIP8_FRAME_FRESH 0x4 // Set in Chip8_Frame_Exchange.middle while it holds an unseen frame
+
+// Lock-free triple buffer. The emulation thread fills `back` and swaps it with `middle`, the SDL
+// thread swaps `front` with a fresh `middle`. Neither side waits and the SDL thread always gets
+// the latest completed frame
+typedef struct Chip8_Frame_Exchange {
+    uint64_t slots[3][CHIP8_DH];
+    uint8_t  back;   // Owned by the emulation thread
+    uint8_t  front;  // Owned by the SDL thread
+    uint8_t  middle; // Atomic, slot index | CHIP8_FRAME_FRESH
+} Chip8_Frame_Exchange;
+
+// The CPU, its scheduler and the timers live on the emulation thread. The SDL thread only talks to
+// it through the atomics below and the frame exchange
+typedef struct Chip8_Emulator {
+    Chip8_CPU           *cpu;
+    Chip8_Scheduler      sched;
+    Chip8_Synth          synth;
+    Chip8_Frame_Exchange frames;
+    SDL_sem             *wake;    // Posted on input so an idle CPU sees it at once
+    uint32_t             keys;    // Atomic, bit i set while key i is held
+    bool                 turbo;   // Atomic, set while fast-forwarding
+    bool                 rewinding; // Atomic, set while running backwards
+    bool                 quit;    // Atomic, asks the emulation thread to stop
+    bool                 stopped; // Atomic, the emulation thread stopped on `status`
+    Chip8_Status         status;
+    const char          *trace_path;
+    bool                 flush_trace; // Atomic, asks the emulation thread to write the trace
+    Chip8_Movie         *movie;       // Recording, NULL once it stopped
+    const char          *state_path;
+    bool                 save_state;  // Atomic, asks the emulation thread to write a snapshot
+    bool                 load_state;  // Atomic, asks the emulation thread to restore it
+} Chip8_Emulator;
+
+// Emulation thread: queue samples, dropping what doesn't fit
+void chip8_audio_push(Chip8_Audio_Ring *ring, const int16_t *samples, size_t count)
+{
+    uint32_t head = ring->head;
+    uint32_t room = CHIP8_AUDIO_RING - (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE));
+    if (count > room) {
+        ring->dropped += count - room;
+        count = room;
+    }
+    for (size_t i = 0; i < count; ++i) ring->samples[(head + i) & (CHIP8_AUDIO_RING - 1)] = samples[i];
+    __atomic_store_n(&ring->head, head + (uint32_t)count, __ATOMIC_RELEASE);
+}
+
+void chip8_audio_callback(void *UserData, uint8_t *stream, int len)
+{
+    Chip8_Sound *sound = (Chip8_Sound*)UserData;
+    Chip8_Audio_Ring *ring = &sound->ring;
+    int16_t *buffer = (int16_t*)stream;
+    int sample_to_fill = len / sizeof(int16_t);
+
+    uint32_t tail = ring->tail;
+    uint32_t fill = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+
+    // After an underrun wait for a full cushion again instead of crackling on every sample
+    if (!sound->primed && fill < sound->target) {
+        memset(stream, 0, len);
+        return;
+    }
+    sound->primed = true;
+
+    // Way behind, e.g. after the window was dragged: drop the backlog instead of lagging behind
+    if (fill > 4 * sound->target) {
+        tail += fill - sound->target;
+        fill  = sound->target;
+        sound->position = 0;
+    }
+
+    double error = ((double)fill - sound->target) / sound->target;
+    if (error >  1.0) error =  1.0;
+    if (error < -1.0) error = -1.0;
+    double step = 1.0 + CHIP8_AUDIO_MAX_SKEW * error;
+
+    for (int i = 0; i < sample_to_fill; ++i) {
+        uint32_t offset = (uint32_t)sound->position;
+        if (offset >= fill) {
+            memset(&buffer[i], 0, (sample_to_fill - i) * sizeof(int16_t));
+            sound->primed = false;
+            sound->underruns++;
+            break;
+        }
+        buffer[i] = ring->samples[(tail + offset) & (CHIP8_AUDIO_RING - 1)];
+        sound->position += step;
+    }
+
+    uint32_t consumed = (uint32_t)sound->position;
+    if (consumed > fill) consumed = fill;
+    sound->position -= consumed;
+    __atomic_store_n(&ring->tail, tail + consumed, __ATOMIC_RELEASE);
+}
+
+void chip8_initialize_sound(Chip8_Sound *sound, uint16_t buffer_samples)
+{
+    memset(sound, 0, sizeof(Chip8_Sound));
+    sound->sample_rate    = CHIP8_SOUND_SAMPLES;
+    sound->buffer_samples = buffer_samples;
+    sound->target         = 2 * buffer_samples;
+}
+
+bool chip8_open_audio_device(Chip8_Sound *sound)
+{
+    SDL_AudioSpec want, have;
+
+    memset(&want, 0, sizeof(want));
+    want.freq = sound->sample_rate;
+    want.format = AUDIO_S16SYS;
+    want.channels = 1;
+    want.samples = sound->buffer_samples;
+    want.callback = chip8_audio_callback;
+    want.userdata = sound;
+
+    // The callback writes S16 samples, let SDL convert if the device wants something else
+    sound->dev = SDL_OpenAudioDevice(NULL, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if (sound->dev == 0) {
+        CHIP8_SDL_ERROR("Failed to Open Audio Device", false);
+    }
+    sound->sample_rate = have.freq;
+    sound->target      = 2 * have.samples;
+    // A device may hand back a larger buffer than asked for, the callback could never prime on it
+    if (sound->target > CHIP8_AUDIO_RING / 4) {
+        fprintf(stdout, "[INFO] Audio device buffer of %u samples, keeping the cushion at %d\n",
+                (unsigned)have.samples, CHIP8_AUDIO_RING / 4);
+        sound->target = CHIP8_AUDIO_RING / 4;
+    }
+
+    SDL_PauseAudioDevice(sound->dev, 0);
+    return true;
+}
+
+// SDL Representation of 0 - F Keys
+const SDL_Keycode chip8_keys[CHIP8_FONT_COUNT] = {
+    [CHIP8_ZERO]  = SDLK_x,
+    [CHIP8_ONE]   = SDLK_1,
+    [CHIP8_TWO]   = SDLK_2,
+    [CHIP8_THREE] = SDLK_3,
+    [CHIP8_FOUR]  = SDLK_q,
+    [CHIP8_FIVE]  = SDLK_w,
+    [CHIP8_SIX]   = SDLK_e,
+    [CHIP8_SEVEN] = SDLK_a,
+    [CHIP8_EIGHT] = SDLK_s,
+    [CHIP8_NINE]  = SDLK_d,
+    [CHIP8_A]     = SDLK_z,
+    [CHIP8_B]     = SDLK_c,
+    [CHIP8_C]     = SDLK_4,
+    [CHIP8_D]     = SDLK_r,
+    [CHIP8_E]     = SDLK_f,
+    [CHIP8_F]     = SDLK_v,
+};
+
+// Update the key bitmask read by the emulation thread, returns true if a CHIP-8 key changed
+bool chip8_handle_input(uint32_t *keys, SDL_Event *event)
+{
+    switch (event->type) {
+    case SDL_KEYDOWN: {
+        for (uint8_t i = 0; i < CHIP8_FONT_COUNT; ++i) {
+            if (event->key.keysym.sym == chip8_keys[i]) {
+                __atomic_fetch_or(keys, 1u << i, __ATOMIC_RELEASE);
+                return true;
+            }
+        }
+    } break;
+
+    case SDL_KEYUP: {
+        for (uint8_t i = 0; i < CHIP8_FONT_COUNT; ++i) {
+            if (event->key.keysym.sym == chip8_keys[i]) {
+                __atomic_fetch_and(keys, ~(1u << i), __ATOMIC_RELEASE);
+                return true;
+            }
+        }
+    } break;
+
+    default: {
+        fprintf(stderr, "[PANIC] Unreachable SDL_Type");
+        exit(EXIT_FAILURE);
+    }
+    }
+    return false;
+}
+
+bool chip8_clear_background(SDL_Renderer *renderer, const Chip8_Color color)
+{
+    int ret;
+    ret = SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a); // Set Background Color
+    if (ret != 0) {
+        CHIP8_SDL_ERROR("SDL_SetRenderDrawColor", false);
+    }
+
+    ret = SDL_RenderClear(renderer); // Clear Background with Set Color
+    if (ret != 0) {
+        CHIP8_SDL_ERROR("SDL_RenderClear", false);
+    }
+    return true;
+}
+
+static uint32_t chip8_color_to_argb(const Chip8_Color color)
+{
+    return ((uint32_t)color.a << 24) | ((uint32_t)color.r << 16) | ((uint32_t)color.g << 8) | color.b;
+}
+
+bool chip8_create_display(Chip8_Display *display, SDL_Renderer *renderer)
+{
+    memset(display, 0, sizeof(Chip8_Display));
+    display->texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                         CHIP8_DW, CHIP8_DH);
+    if (display->texture == NULL) {
+        CHIP8_SDL_ERROR("SDL_CreateTexture", false);
+    }
+    return true;
+}
+
+// Convert the frame buffer to ARGB and upload it, unless the texture already shows this frame
+bool chip8_update_display(Chip8_Display *display, const uint64_t *frame_buffer, const Chip8_Color on, const Chip8_Color off)
+{
+    if (display->uploaded && memcmp(display->shown, frame_buffer, sizeof(display->shown)) == 0) {
+        return true;
+    }
+
+    const uint32_t on_argb  = chip8_color_to_argb(on);
+    const uint32_t off_argb = chip8_color_to_argb(off);
+    for (int j = 0; j < CHIP8_DH; ++j) {
+        uint64_t row = frame_buffer[j];
+        for (int i = 0; i < CHIP8_DW; ++i) {
+            display->pixels[j][i] = (row >> (CHIP8_DW - 1 - i)) & 1 ? on_argb : off_argb;
+        }
+    }
+
+    if (SDL_UpdateTexture(display->texture, NULL, display->pixels, sizeof(display->pixels[0])) != 0) {
+        CHIP8_SDL_ERROR("SDL_UpdateTexture", false);
+    }
+    memcpy(display->shown, frame_buffer, sizeof(display->shown));
+    display->uploaded = true;
+
+#if CHIP8_DEBUG_RENDER
+    fprintf(stdout, "[INFO] Frame buffer uploaded to the display texture\n");
+#endif
+    return true;
+}
+
+bool chip8_render_display(const Chip8_Display *display, SDL_Renderer *renderer)
+{
+    // One scaled copy of the 64x32 texture covers the whole window
+    if (SDL_RenderCopy(renderer, display->texture, NULL, NULL) != 0) {
+        CHIP8_SDL_ERROR("SDL_RenderCopy", false);
+    }
+    return true;
+}
+
+// Ask for a vsynced renderer, falling back to whatever SDL can give us
+SDL_Renderer *chip8_create_renderer(SDL_Window *window, bool *vsync)
+{
+    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    if (renderer == NULL) renderer = SDL_CreateRenderer(window, -1, 0);
+    if (renderer == NULL) return NULL;
+
+    SDL_RendererInfo info;
+    *vsync = SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_PRESENTVSYNC);
+    return renderer;
+}
+
+void chip8_init_frame_pacer(Chip8_Frame_Pacer *pacer, SDL_Window *window, bool vsync)
+{
+    SDL_DisplayMode mode;
+    int refresh_rate = CHIP8_REFRESH_RATE;
+    if (SDL_GetWindowDisplayMode(window, &mode) == 0 && mode.refresh_rate > 0) refresh_rate = mode.refresh_rate;
+
+    pacer->vsync      = vsync;
+    pacer->frequency  = SDL_GetPerformanceFrequency();
+    pacer->period     = pacer->frequency / refresh_rate;
+    pacer->next_frame = SDL_GetPerformanceCounter() + pacer->period;
+}
+
+// Block until the next display refresh or SDL event. A vsynced present has already waited for it
+void chip8_wait_next_frame(Chip8_Frame_Pacer *pacer, bool presented)
+{
+    uint64_t now = SDL_GetPerformanceCounter();
+    if ((pacer->vsync && presented) || now >= pacer->next_frame) {
+        // Line up with the refresh we just hit, a late frame isn't made up for
+        pacer->next_frame = now + pacer->period;
+        return;
+    }
+
+    // Round up, waking a little late only delays the present that follows
+    int ms = (int)((pacer->next_frame - now + pacer->frequency / 1000 - 1) * 1000 / pacer->frequency);
+    if (SDL_WaitEventTimeout(NULL, ms)) return;
+    pacer->next_frame += pacer->period;
+}
+
+void chip8_init_scheduler(Chip8_Scheduler *sched, double speed, uint64_t max_catchup_ms, uint64_t late_after)
+{
+    memset(sched, 0, sizeof(Chip8_Scheduler));
+    sched->frequency   = SDL_GetPerformanceFrequency();
+    sched->rate        = (uint64_t)(CHIP8_CPU_HZ * speed + 0.5);
+    if (sched->rate == 0) sched->rate = 1;
+    sched->last        = SDL_GetPerformanceCounter();
+    sched->max_catchup = max_catchup_ms * sched->frequency / 1000;
+    sched->late_after  = late_after;
+    // Replaying less than a display refresh would drop cycles every frame and slow the emulator down
+    if (sched->max_catchup < late_after) sched->max_catchup = late_after;
+}
+
+// Cycles due since the previous call
+uint64_t chip8_scheduler_due(Chip8_Scheduler *sched)
+{
+    const uint64_t hz = sched->rate;
+    uint64_t now = SDL_GetPerformanceCounter();
+    uint64_t elapsed = now - sched->last;
+    sched->last = now;
+
+    if (elapsed > sched->max_catchup) {
+        sched->dropped_cycles += (elapsed - sched->max_catchup) * hz / sched->frequency;
+        elapsed = sched->max_catchup;
+    }
+    if (elapsed > sched->late_after) {
+        sched->late_cycles += (elapsed - sched->late_after) * hz / sched->frequency;
+    }
+
+    sched->remainder += elapsed * hz;
+    uint64_t due = sched->remainder / sched->frequency;
+    sched->remainder %= sched->frequency;
+    return due;
+}
+
+// Queue the samples for the cycles run so far. Called before every timer tick so ST holds its value
+// for the whole stretch
+static void chip8_scheduler_audio(Chip8_Scheduler *sched, const Chip8_CPU *cpu)
+{
+    if (sched->synth == NULL) return;
+
+    int16_t block[256];
+    size_t count;
+    while ((count = chip8_synth_render(sched->synth, cpu->chip8_cycles, cpu->chip8_s_timer > 0, block, 256)) > 0) {
+        chip8_audio_push(sched->ring, block, count);
+    }
+}
+
+// Run `cycles` instructions, ticking the timers every CHIP8_CPU_HZ / CHIP8_TIMER_HZ of them
+Chip8_Status chip8_scheduler_run(Chip8_Scheduler *sched, Chip8_CPU *cpu, uint64_t cycles)
+{
+    uint64_t target = cpu->chip8_cycles + cycles;
+    while (cpu->chip8_cycles < target) {
+        uint64_t tick_at = (uint64_t)((double)(sched->timer_frames + 1) * CHIP8_CPU_HZ / CHIP8_TIMER_HZ);
+        uint64_t stop    = tick_at < target ? tick_at : target;
+        if (stop > cpu->chip8_cycles) {
+            Chip8_Status status = chip8_run_cycles(cpu, stop - cpu->chip8_cycles);
+            chip8_scheduler_audio(sched, cpu);
+            if (status != CHIP8_OK) return status;
+        }
+        if (cpu->chip8_cycles >= tick_at) {
+            chip8_tick_timers(cpu);
+            sched->timer_frames++;
+            if (sched->rewind != NULL) chip8_rewind_push(sched->rewind, cpu);
+        }
+    }
+    return CHIP8_OK;
+}
+
+// Run as many cycles as fit before `deadline`, the timers still tick off the cycle count
+Chip8_Status chip8_scheduler_turbo(Chip8_Scheduler *sched, Chip8_CPU *cpu, uint64_t deadline)
+{
+    // Fast-forwarded cycles would flood the audio ring, they play as silence
+    Chip8_Synth *synth = sched->synth;
+    sched->synth = NULL;
+
+    Chip8_Status status = CHIP8_OK;
+    do {
+        status = chip8_scheduler_run(sched, cpu, CHIP8_TURBO_SLICE);
+    } while (status == CHIP8_OK && SDL_GetPerformanceCounter() < deadline);
+
+    sched->synth = synth;
+    if (synth != NULL) chip8_synth_skip(synth, cpu->chip8_cycles);
+
+    // Time spent in turbo isn't owed to the normal schedule
+    sched->last      = SDL_GetPerformanceCounter();
+    sched->remainder = 0;
+    return status;
+}
+
+// Step back through the recorded frames at the rate the CPU would have run forward
+void chip8_scheduler_rewind(Chip8_Scheduler *sched, Chip8_CPU *cpu)
+{
+    uint64_t due = chip8_scheduler_due(sched);
+    sched->rewind_to = sched->rewind_to > due ? sched->rewind_to - due : 0;
+
+    bool moved = false;
+    while (cpu->chip8_cycles > sched->rewind_to && chip8_rewind_pop(sched->rewind, cpu)) moved = true;
+    if (!moved) return;
+
+    // Carry on from the restored frame, the beep stays silent while going backwards
+    sched->timer_frames = chip8_timer_frames_at(cpu->chip8_cycles);
+    if (sched->synth != NULL) chip8_synth_skip(sched->synth, cpu->chip8_cycles);
+}
+
+void chip8_init_frame_exchange(Chip8_Frame_Exchange *frames)
+{
+    memset(frames, 0, sizeof(Chip8_Frame_Exchange));
+    frames->back   = 0;
+    frames->middle = 1;
+    frames->front  = 2;
+}
+
+// Emulation thread: hand over a copy of the frame buffer
+void chip8_publish_frame(Chip8_Frame_Exchange *frames, const Chip8_CPU *cpu)
+{
+    memcpy(frames->slots[frames->back], cpu->chip8_frame_buffer, sizeof(frames->slots[0]));
+    uint8_t old = __atomic_exchange_n(&frames->middle, frames->back | CHIP8_FRAME_FRESH, __ATOMIC_ACQ_REL);
+    frames->back = old & ~CHIP8_FRAME_FRESH;
+}
+
+// SDL thread: the latest frame published since the last call, or NULL
+const uint64_t *chip8_take_frame(Chip8_Frame_Exchange *frames)
+{
+    if (!(__atomic_load_n(&frames->middle, __ATOMIC_ACQUIRE) & CHIP8_FRAME_FRESH)) return NULL;
+    uint8_t old = __atomic_exchange_n(&frames->middle, frames->front, __ATOMIC_ACQ_REL);
+    frames->front = old & ~CHIP8_FRAME_FRESH;
+    return frames->slots[frames->front];
+}
+
+// Milliseconds until the next timer tick, at least 1
+uint32_t chip8_ms_to_next_tick(const Chip8_Scheduler *sched, const Chip8_CPU *cpu)
+{
+    uint64_t tick_at = (uint64_t)((double)(sched->timer_frames + 1) * CHIP8_CPU_HZ / CHIP8_TIMER_HZ);
+    uint64_t cycles  = tick_at > cpu->chip8_cycles ? tick_at - cpu->chip8_cycles : 0;
+    uint64_t ms      = cycles * 1000 / sched->rate;
+    return ms > 0 ? (uint32_t)ms : 1;
+}
+
+// Runs the CPU and timers off the scheduler, independently of rendering and presenting
+int chip8_emulation_thread(void *data)
+{
+    Chip8_Emulator *emu = data;
+    Chip8_CPU *cpu = emu->cpu;
+    Chip8_Status status = CHIP8_OK;
+    bool was_rewinding = false;
+
+    chip8_publish_frame(&emu->frames, cpu);
+    while (!__atomic_load_n(&emu->quit, __ATOMIC_ACQUIRE)) {
+        uint32_t keys = __atomic_load_n(&emu->keys, __ATOMIC_ACQUIRE);
+        for (uint8_t i = 0; i < CHIP8_FONT_COUNT; ++i) cpu->chip8_key_state[i] = (keys >> i) & 1;
+        if (emu->movie != NULL) chip8_movie_record(emu->movie, cpu->chip8_cycles, (uint16_t)keys);
+
+        // Run the CPU at 700Hz times --speed, the timers tick every 700/60 cycles
+        bool rewinding = emu->sched.rewind != NULL && __atomic_load_n(&emu->rewinding, __ATOMIC_ACQUIRE);
+        bool turbo = !rewinding && __atomic_load_n(&emu->turbo, __ATOMIC_ACQUIRE);
+        if (rewinding) {
+            if (!was_rewinding) emu->sched.rewind_to = cpu->chip8_cycles;
+            chip8_scheduler_rewind(&emu->sched, cpu);
+            // The movie picks up again from the frame rewound to
+            if (emu->movie != NULL) chip8_movie_truncate(emu->movie, cpu->chip8_cycles);
+        } else if (turbo) {
+            uint64_t deadline = SDL_GetPerformanceCounter() + emu->sched.frequency * CHIP8_TURBO_BURST_MS / 1000;
+            status = chip8_scheduler_turbo(&emu->sched, cpu, deadline);
+        } else {
+            status = chip8_scheduler_run(&emu->sched, cpu, chip8_scheduler_due(&emu->sched));
+        }
+
+        if (__atomic_exchange_n(&emu->flush_trace, false, __ATOMIC_ACQ_REL) && cpu->chip8_tracer != NULL) {
+            if (chip8_tracer_flush(cpu->chip8_tracer, emu->trace_path, CHIP8_OK)) {
+                fprintf(stdout, "[INFO] Trace written to `%s`\n", emu->trace_path);
+            }
+        }
+        if (__atomic_exchange_n(&emu->save_state, false, __ATOMIC_ACQ_REL)) {
+            if (chip8_snapshot_write_file(cpu, emu->state_path)) {
+                fprintf(stdout, "[INFO] State saved to `%s`\n", emu->state_path);
+            }
+        }
+        if (__atomic_exchange_n(&emu->load_state, false, __ATOMIC_ACQ_REL)) {
+            if (emu->movie != NULL) chip8_movie_record(emu->movie, cpu->chip8_cycles, emu->movie->keys);
+            if (chip8_snapshot_read_file(cpu, emu->state_path)) {
+                // A snapshot may come from another run, the movie can't follow it there
+                if (emu->movie != NULL) {
+                    fprintf(stdout, "[INFO] Movie recording stopped at cycle %lu\n", (unsigned long)emu->movie->end_cycle);
+                    emu->movie = NULL;
+                }
+                // Pick the timer and audio schedule up at the restored cycle count
+                emu->sched.timer_frames = chip8_timer_frames_at(cpu->chip8_cycles);
+                chip8_synth_skip(&emu->synth, cpu->chip8_cycles);
+                status = CHIP8_OK;
+                fprintf(stdout, "[INFO] State loaded from `%s`\n", emu->state_path);
+            }
+        }
+
+        if (cpu->chip8_display_dirty) {
+            chip8_publish_frame(&emu->frames, cpu);
+            cpu->chip8_display_dirty = false;
+        }
+        if (status != CHIP8_OK) break;
+        was_rewinding = rewinding;
+
+        // An idle or rewinding CPU has nothing to do before the next timer tick or key change
+        if (!turbo) {
+            bool wait_tick = cpu->chip8_idle || rewinding;
+            SDL_SemWaitTimeout(emu->wake, wait_tick ? chip8_ms_to_next_tick(&emu->sched, cpu) : 1);
+        }
+    }
+
+    emu->status = status;
+    __atomic_store_n(&emu->stopped, true, __ATOMIC_RELEASE);
+    return 0;
+}
+#endif // !CHIP8_NO_SDL
+
+const char *chip8_shift_args(int *argc, char ***argv)
+{
+    const char *result = **argv;
+    (*argc)--;
+    (*argv)++;
+    return result;
+}
+
+bool chip8_parse_u64(const char *flag, const char *value, uint64_t *out)
+{
+    if (value == NULL) {
+        fprintf(stderr, "[ERROR] Missing value for `%s`\n", flag);
+        return false;
+    }
+
+    char *end = NULL;
+    errno = 0;
+    unsigned long long result = strtoull(value, &end, 10);
+    if (errno != 0 || end == value || *end != '\0') {
+        fprintf(stderr, "[ERROR] Invalid value `%s` for `%s`\n", value, flag);
+        return false;
+    }
+
+    *out = result;
+    return true;
+}
+
+bool chip8_parse_speed(const char *flag, const char *value, double *out)
+{
+    if (value == NULL) {
+        fprintf(stderr, "[ERROR] Missing value for `%s`\n", flag);
+        return false;
+    }
+
+    char *end = NULL;
+    errno = 0;
+    double result = strtod(value, &end);
+    if (errno != 0 || end == value || *end != '\0' || !(result > 0.0)) {
+        fprintf(stderr, "[ERROR] Invalid value `%s` for `%s`\n", value, flag);
+        return false;
+    }
+
+    *out = result;
+    return true;
+}
+
+bool chip8_initialize_states(Chip8_CPU *cpu, const char *chip8_rom_path)
+{
+    chip8_reset(cpu);
+
+    // Load the chip8 Rom into chip8 ram
+    if (!chip8_read_file_into_memory(cpu, chip8_rom_path)) return false;
+    return true;
+}
+
+// Drive the CPU and the 60Hz timers without video or audio.
+// Timers are derived from the emulated cycle count, so a run is not throttled to real time.
+// With `wav` set, the beep is written to it as a 16-bit mono WAV in emulated time.
+// The limits count from the cycle the CPU starts at, which is not 0 after a restored snapshot.
+// With `movie` set, the keypad follows it cycle for cycle.
+Chip8_Status chip8_run_headless(Chip8_CPU *cpu, uint64_t max_cycles, uint64_t max_frames, FILE *wav, Chip8_Movie *movie)
+{
+    uint64_t frames = chip8_timer_frames_at(cpu->chip8_cycles);
+    uint64_t first_frame = frames;
+    if (max_cycles < UINT64_MAX - cpu->chip8_cycles) max_cycles += cpu->chip8_cycles;
+    else max_cycles = UINT64_MAX;
+    Chip8_Status status = CHIP8_OK;
+
+    Chip8_Synth synth;
+    uint64_t samples = 0;
+    chip8_init_synth(&synth, CHIP8_SOUND_SAMPLES, (uint64_t)CHIP8_CPU_HZ, cpu->chip8_cycles);
+    if (wav != NULL) chip8_wav_begin(wav, CHIP8_SOUND_SAMPLES);
+
+    while (status == CHIP8_OK && frames - first_frame < max_frames && cpu->chip8_cycles < max_cycles) {
+        uint64_t tick_at   = (uint64_t)((double)(frames + 1) * CHIP8_CPU_HZ / CHIP8_TIMER_HZ);
+        uint64_t frame_end = tick_at < max_cycles ? tick_at : max_cycles;
+
+        // Stop at every key change of the movie, the CPU sees it at the same cycle it was recorded at
+        while (status == CHIP8_OK && cpu->chip8_cycles < frame_end) {
+            uint64_t next = movie != NULL ? chip8_movie_play(movie, cpu) : UINT64_MAX;
+            uint64_t stop = next < frame_end ? next : frame_end;
+            status = chip8_run_cycles(cpu, stop - cpu->chip8_cycles);
+        }
+        if (wav != NULL) {
+            int16_t block[256];
+            size_t count;
+            while ((count = chip8_synth_render(&synth, cpu->chip8_cycles, cpu->chip8_s_timer > 0, block, 256)) > 0) {
+                chip8_wav_write(wav, block, count);
+                samples += count;
+            }
+        }
+
+        // A run cut short by --cycles or a fault stops before the tick, as the windowed one does
+        if (cpu->chip8_cycles < tick_at) break;
+        chip8_tick_timers(cpu);
+        frames++;
+    }
+
+    if (wav != NULL && !chip8_wav_finish(wav, samples)) {
+        fprintf(stderr, "[ERROR] Could not finish the WAV file: `%s`\n", strerror(errno));
+    }
+
+    fprintf(stdout, "[INFO] %s after %lu cycles, %lu frames\n",
+            status == CHIP8_OK ? "Stopped" : chip8_status_name(status),
+            (unsigned long)cpu->chip8_cycles, (unsigned long)frames);
+    chip8_dump_state(cpu, stdout);
+    return status;
+}
+
+void chip8_usage(const char *program_name)
+{
+    fprintf(stderr, "[Usage] %s [--headless] [--cycles <n>] [--frames <n>] [--wav <path>] [--speed <x>] [--turbo] [--max-catchup <ms>] [--no-idle-skip] [--profile] [--trace <path>] [--trace-size <n>] [--rewind <seconds>] [--seed <n>] [--record <path>] [--play <path>] [--save-state <path>] [--load-state <path>] [--audio-buffer <n>] [--engine <name>] [--quirks <profile>] <input_path>\n", program_name);
+    fprintf(stderr, "    --headless    Run without video or audio, then dump the final state\n");
+    fprintf(stderr, "    --cycles <n>  Stop a headless run after <n> instructions\n");
+    fprintf(stderr, "    --frames <n>  Stop a headless run after <n> 60Hz frames (default %d)\n", CHIP8_HEADLESS_FRAMES);
+    fprintf(stderr, "    --wav <path>  Write the beep of a headless run to a WAV file\n");
+    fprintf(stderr, "    --speed <x>   Run the CPU and timers at <x> times the normal rate, e.g. 0.5 or 4\n");
+    fprintf(stderr, "    --turbo       Run as fast as the host allows, as while holding Tab\n");
+    fprintf(stderr, "    --max-catchup <ms>  Longest stall replayed after the emulator falls behind, the rest is dropped, at least one display refresh (default %d)\n", CHIP8_MAX_CATCHUP_MS);
+    fprintf(stderr, "    --profile     Count instructions per op class and address, print the hotspots on exit\n");
+    fprintf(stderr, "    --trace <path>  Record the last instructions, written to <path> on exit, on a fault or on F12\n");
+    fprintf(stderr, "    --trace-size <n>  Instructions kept by --trace (default %u)\n", CHIP8_TRACE_SIZE);
+    fprintf(stderr, "    --seed <n>    Seed the CXKK generator, runs with the same seed and input are identical (default: the clock)\n");
+    fprintf(stderr, "    --record <path>  Record every key change with its cycle number to a movie file\n");
+    fprintf(stderr, "    --play <path>    Replay a movie in a headless run, up to where the recording stopped\n");
+    fprintf(stderr, "    --rewind <seconds>  Emulated time kept for rewinding with Backspace, 0 turns it off (default %d)\n", CHIP8_REWIND_SECONDS);
+    fprintf(stderr, "    --save-state <path>  Snapshot file written by F5 and at the end of a headless run that didn't fault (default <input_path>%s)\n", CHIP8_STATE_EXT);
+    fprintf(stderr, "    --load-state <path>  Restore a snapshot before running, F9 restores the --save-state file\n");
+    fprintf(stderr, "    --no-idle-skip  Execute idle loops instead of fast-forwarding to the next timer tick or key\n");
+    fprintf(stderr, "    --audio-buffer <n>  Audio device buffer in samples, a power of two from %d to %d (default %d)\n",
+            CHIP8_SOUND_BUFFER_MIN, CHIP8_SOUND_BUFFER_MAX, CHIP8_SOUND_BUFFER);
+    fprintf(stderr, "    --engine <name>  Interpreter engine:");
+    for (int i = 0; i < CHIP8_ENGINE_COUNT; ++i) fprintf(stderr, " %s", chip8_engine_name((Chip8_Engine)i));
+    fprintf(stderr, " (default %s)\n", chip8_engine_name(CHIP8_ENGINE_CACHED));
+    fprintf(stderr, "    --quirks <profile>  Platform behaviour, any profile but %s runs its own interpreter:", chip8_quirks_name(CHIP8_QUIRKS_LEGACY));
+    for (int i = 0; i < CHIP8_QUIRKS_COUNT; ++i) fprintf(stderr, " %s", chip8_quirks_name((Chip8_Quirks)i));
+    fprintf(stderr, " (default %s)\n", chip8_quirks_name(CHIP8_QUIRKS_LEGACY));
+}
+
+#define chip8_main main
+int chip8_main(int argc, char **argv)
+{
+    // Parse Command-Line Args
+    const char *program_name = chip8_shift_args(&argc, &argv);
+    const char *rom_path = NULL;
+    bool headless = CHIP8_NO_SDL;
+    uint64_t max_cycles = UINT64_MAX;
+    uint64_t max_frames = UINT64_MAX;
+    uint64_t max_catchup_ms = CHIP8_MAX_CATCHUP_MS;
+    double speed = 1.0;
+    bool turbo = false;
+    bool skip_idle = true;
+    uint64_t audio_buffer = CHIP8_SOUND_BUFFER;
+    const char *wav_path = NULL;
+    bool profile = false;
+    const char *trace_path = NULL;
+    uint64_t trace_size = CHIP8_TRACE_SIZE;
+    uint64_t rewind_seconds = CHIP8_REWIND_SECONDS;
+    uint64_t seed = 0;
+    bool seeded = false;
+    const char *record_path = NULL;
+    const char *play_path = NULL;
+    const char *save_state_path = NULL;
+    const char *load_state_path = NULL;
+    Chip8_Engine engine = CHIP8_ENGINE_CACHED;
+    Chip8_Quirks quirks = CHIP8_QUIRKS_LEGACY;
+
+    while (argc > 0) {
+        const char *arg = chip8_shift_args(&argc, &argv);
+        if (strcmp(arg, "--headless") == 0) {
+            headless = true;
+        } else if (strcmp(arg, "--cycles") == 0) {
+            if (!chip8_parse_u64(arg, argc > 0 ? chip8_shift_args(&argc, &argv) : NULL, &max_cycles)) return 1;
+        } else if (strcmp(arg, "--frames") == 0) {
+            if (!chip8_parse_u64(arg, argc > 0 ? chip8_shift_args(&argc, &argv) : NULL, &max_frames)) return 1;
+        } else if (strcmp(arg, "--speed") == 0) {
+            if (!chip8_parse_speed(arg, argc > 0 ? chip8_shift_args(&argc, &argv) : NULL, &speed)) return 1;
+        } else if (strcmp(arg, "--wav") == 0) {
+            wav_path = argc > 0 ? chip8_shift_args(&argc, &argv) : NULL;
+            if (wav_path == NULL) {
+                fprintf(stderr, "[ERROR] Missing value for `%s`\n", arg);
+                return 1;
+            }
+        } else if (strcmp(arg, "--audio-buffer") == 0) {
+            if (!chip8_parse_u64(arg, argc > 0 ? chip8_shift_args(&argc, &argv) : NULL, &audio_buffer)) return 1;
+            if (audio_buffer < CHIP8_SOUND_BUFFER_MIN || audio_buffer > CHIP8_SOUND_BUFFER_MAX || (audio_buffer & (audio_buffer - 1))) {
+                fprintf(stderr, "[ERROR] `%s` takes a power of two from %d to %d\n", arg, CHIP8_SOUND_BUFFER_MIN, CHIP8_SOUND_BUFFER_MAX);
+                return 1;
+            }
+        } else if (strcmp(arg, "--trace") == 0) {
+            trace_path = argc > 0 ? chip8_shift_args(&argc, &argv) : NULL;
+            if (trace_path == NULL) {
+                fprintf(stderr, "[ERROR] Missing value for `%s`\n", arg);
+                return 1;
+            }
+        } else if (strcmp(arg, "--trace-size") == 0) {
+            if (!chip8_parse_u64(arg, argc > 0 ? chip8_shift_args(&argc, &argv) : NULL, &trace_size)) return 1;
+            if (trace_size == 0) {
+                fprintf(stderr, "[ERROR] `%s` must be at least 1\n", arg);
+                return 1;
+            }
+        } else if (strcmp(arg, "--seed") == 0) {
+            if (!chip8_parse_u64(arg, argc > 0 ? chip8_shift_args(&argc, &argv) : NULL, &seed)) return 1;
+            seeded = true;
+        } else if (strcmp(arg, "--record") == 0) {
+            record_path = argc > 0 ? chip8_shift_args(&argc, &argv) : NULL;
+            if (record_path == NULL) {
+                fprintf(stderr, "[ERROR] Missing value for `%s`\n", arg);
+                return 1;
+            }
+        } else if (strcmp(arg, "--play") == 0) {
+            play_path = argc > 0 ? chip8_shift_args(&argc, &argv) : NULL;
+            if (play_path == NULL) {
+                fprintf(stderr, "[ERROR] Missing value for `%s`\n", arg);
+                return 1;
+            }
+        } else if (strcmp(arg, "--rewind") == 0) {
+            if (!chip8_parse_u64(arg, argc > 0 ? chip8_shift_args(&argc, &argv) : NULL, &rewind_seconds)) return 1;
+        } else if (strcmp(arg, "--save-state") == 0) {
+            save_state_path = argc > 0 ? chip8_shift_args(&argc, &argv) : NULL;
+            if (save_state_path == NULL) {
+                fprintf(stderr, "[ERROR] Missing value for `%s`\n", arg);
+                return 1;
+            }
+        } else if (strcmp(arg, "--load-state") == 0) {
+            load_state_path = argc > 0 ? chip8_shift_args(&argc, &argv) : NULL;
+            if (load_state_path == NULL) {
+                fprintf(stderr, "[ERROR] Missing value for `%s`\n", arg);
+                return 1;
+            }
+        } else if (strcmp(arg, "--profile") == 0) {
+            profile = true;
+        } else if (strcmp(arg, "--no-idle-skip") == 0) {
+            skip_idle = false;
+        } else if (strcmp(arg, "--turbo") == 0) {
+            turbo = true;
+        } else if (strcmp(arg, "--max-catchup") == 0) {
+            if (!chip8_parse_u64(arg, argc > 0 ? chip8_shift_args(&argc, &argv) : NULL, &max_catchup_ms)) return 1;
+            if (max_catchup_ms == 0) {
+                fprintf(stderr, "[ERROR] `%s` takes at least 1 millisecond\n", arg);
+                return 1;
+            }
+        } else if (strcmp(arg, "--engine") == 0) {
+            const char *name = argc > 0 ? chip8_shift_args(&argc, &argv) : "";
+            if (!chip8_parse_engine(name, &engine)) {
+                fprintf(stderr, "[ERROR] Unknown engine `%s`\n", name);
+                chip8_usage(program_name);
+                return 1;
+            }
+        } else if (strcmp(arg, "--quirks") == 0) {
+            const char *name = argc > 0 ? chip8_shift_args(&argc, &argv) : "";
+            if (!chip8_parse_quirks(name, &quirks)) {
+                fprintf(stderr, "[ERROR] Unknown quirk profile `%s`\n", name);
+                chip8_usage(program_name);
+                return 1;
+            }
+        } else if (rom_path == NULL) {
+            rom_path = arg;
+        } else {
+            fprintf(stderr, "[ERROR] Unexpected argument `%s`\n", arg);
+            chip8_usage(program_name);
+            return 1;
+        }
+    }
+
+    if (rom_path == NULL) {
+        chip8_usage(program_name);
+        return 1;
+    }
+    if (play_path != NULL && (!headless || record_path != NULL)) {
+        fprintf(stderr, "[ERROR] `--play` needs `--headless` and can't be combined with `--record`\n");
+        return 1;
+    }
+
+    static Chip8_CPU cpu = {0};
+    if (!chip8_initialize_states(&cpu, rom_path)) return 1;
+    chip8_seed_random(&cpu, seeded ? (uint32_t)seed : (uint32_t)time(NULL));
+    cpu.chip8_engine    = engine;
+    cpu.chip8_quirks    = quirks;
+    cpu.chip8_skip_idle = skip_idle;
+    if (load_state_path != NULL && !chip8_snapshot_read_file(&cpu, load_state_path)) return 1;
+
+    // The movie starts from the state after --load-state and carries the generator state with it
+    static Chip8_Movie movie = {0};
+    if (play_path != NULL) {
+        if (!chip8_movie_read(&movie, play_path)) return 1;
+        if (!chip8_movie_start(&movie, &cpu)) return 1;
+    } else if (record_path != NULL) {
+        chip8_movie_begin(&movie, &cpu);
+    }
+
+    static Chip8_Profile profile_counts = {0};
+    if (profile) cpu.chip8_profile = &profile_counts;
+
+    static Chip8_Tracer tracer = {0};
+    if (trace_path != NULL) {
+        if (!chip8_tracer_init(&tracer, trace_size)) return 1;
+        cpu.chip8_tracer = &tracer;
+    }
+
+    if (headless) {
+        // Headless runs are never throttled, --speed and --turbo have nothing to change
+        (void)speed;
+        (void)turbo;
+        (void)rewind_seconds;
+        if (max_cycles == UINT64_MAX && max_frames == UINT64_MAX) {
+            if (play_path != NULL) max_cycles = movie.end_cycle - movie.start_cycle;
+            else max_frames = CHIP8_HEADLESS_FRAMES;
+        }
+        FILE *wav = NULL;
+        if (wav_path != NULL) {
+            wav = fopen(wav_path, "wb");
+            if (wav == NULL) {
+                fprintf(stderr, "[ERROR] Could not open `%s`: `%s`\n", wav_path, strerror(errno));
+                return 1;
+            }
+        }
+        Chip8_Status status = chip8_run_headless(&cpu, max_cycles, max_frames, wav, play_path != NULL ? &movie : NULL);
+        if (wav != NULL) fclose(wav);
+        if (record_path != NULL) {
+            chip8_movie_record(&movie, cpu.chip8_cycles, movie.keys);
+            chip8_movie_write(&movie, record_path);
+        }
+        chip8_movie_free(&movie);
+        // After a fault PC is already past the faulting instruction, a restored run would skip it
+        if (save_state_path != NULL && status != CHIP8_OK) {
+            fprintf(stdout, "[INFO] State not saved, the run stopped with `%s`\n", chip8_status_name(status));
+        } else if (save_state_path != NULL && chip8_snapshot_write_file(&cpu, save_state_path)) {
+            fprintf(stdout, "[INFO] State saved to `%s`\n", save_state_path);
+        }
+        chip8_profile_report(&cpu, stdout, CHIP8_PROFILE_TOP);
+        if (trace_path != NULL) {
+            chip8_tracer_flush(&tracer, trace_path, status);
+            chip8_tracer_free(&tracer);
+        }
+        return status == CHIP8_OK ? 0 : 1;
+    }
+
+#if CHIP8_NO_SDL
+    return 1; // Unreachable: headless-only build
+#else
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
+        CHIP8_SDL_ERROR("Failed to Initialize SDL", 1);
+    }
+
+    const char *prefix     = "Chip8";
+    const int prefix_len   = strlen(prefix);
+    const int rom_path_len = strlen(rom_path);
+    const int buffer_len = prefix_len + rom_path_len;
+    char title[buffer_len + 1];
+
+    snprintf(title, buffer_len, "%s - %s", prefix, rom_path);
+    title[buffer_len] = '\0';
+
+    SDL_Window *window = SDL_CreateWindow(title,
+                                          SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                          CHIP8_WINDOW_WIDTH, CHIP8_WINDOW_HEIGHT,
+                                          SDL_WINDOW_RESIZABLE);
+    if (window == NULL) {
+        CHIP8_SDL_ERROR("Failed to Create Window", 1);
+    }
+
+    bool vsync = false;
+    SDL_Renderer *renderer = chip8_create_renderer(window, &vsync);
+    if (renderer == NULL) {
+        CHIP8_SDL_ERROR("Failed to Create Renderer", 1);
+    }
+
+    Chip8_Frame_Pacer pacer;
+    chip8_init_frame_pacer(&pacer, window, vsync);
+
+    static Chip8_Display display = {0};
+    if (!chip8_create_display(&display, renderer)) return 1;
+
+    static Chip8_Sound sound = {0};
+    chip8_initialize_sound(&sound, (uint16_t)audio_buffer);
+
+    // Open Audio Device
+    if (!chip8_open_audio_device(&sound)) return 1;
+
+    // F5 and F9 share one snapshot file
+    char default_state_path[strlen(rom_path) + sizeof(CHIP8_STATE_EXT)];
+    snprintf(default_state_path, sizeof(default_state_path), "%s%s", rom_path, CHIP8_STATE_EXT);
+
+    static Chip8_Emulator emu = {0};
+    emu.cpu   = &cpu;
+    emu.turbo = turbo;
+    emu.trace_path = trace_path;
+    emu.movie      = record_path != NULL ? &movie : NULL;
+    emu.state_path = save_state_path != NULL ? save_state_path
+                   : load_state_path != NULL ? load_state_path : default_state_path;
+    chip8_init_scheduler(&emu.sched, speed, max_catchup_ms, pacer.period);
+    emu.sched.timer_frames = chip8_timer_frames_at(cpu.chip8_cycles);
+    chip8_init_synth(&emu.synth, sound.sample_rate, emu.sched.rate, cpu.chip8_cycles);
+    emu.sched.synth = &emu.synth;
+    emu.sched.ring  = &sound.ring;
+
+    static Chip8_Rewind rewind = {0};
+    if (rewind_seconds > 0) {
+        size_t frames = (size_t)(rewind_seconds * CHIP8_TIMER_HZ);
+        if (!chip8_rewind_init(&rewind, frames, rewind_seconds * CHIP8_REWIND_BYTES_PER_SECOND)) return 1;
+        emu.sched.rewind = &rewind;
+    }
+    chip8_init_frame_exchange(&emu.frames);
+
+    emu.wake = SDL_CreateSemaphore(0);
+    if (emu.wake == NULL) {
+        CHIP8_SDL_ERROR("Failed to Create Semaphore", 1);
+    }
+    SDL_Thread *thread = SDL_CreateThread(chip8_emulation_thread, "chip8", &emu);
+    if (thread == NULL) {
+        CHIP8_SDL_ERROR("Failed to Create Emulation Thread", 1);
+    }
+
+    bool quit   = false;
+    bool redraw = true; // Present even without a new frame, e.g. after the window was exposed
+    while (!quit) {
+        SDL_Event event;
+        while (SDL_PollEvent(&event)) {
+            switch (event.type) {
+            case SDL_QUIT: quit = true; break;
+            case SDL_WINDOWEVENT: redraw = true; break; // Exposed, resized, ...
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+                if (event.key.keysym.sym == CHIP8_TURBO_KEY) {
+                    __atomic_store_n(&emu.turbo, turbo || event.type == SDL_KEYDOWN, __ATOMIC_RELEASE);
+                } else if (event.key.keysym.sym == CHIP8_REWIND_KEY) {
+                    __atomic_store_n(&emu.rewinding, event.type == SDL_KEYDOWN, __ATOMIC_RELEASE);
+                    SDL_SemPost(emu.wake);
+                } else if (event.key.keysym.sym == CHIP8_TRACE_KEY) {
+                    if (event.type == SDL_KEYDOWN && trace_path != NULL) {
+                        __atomic_store_n(&emu.flush_trace, true, __ATOMIC_RELEASE);
+                        SDL_SemPost(emu.wake);
+                    }
+                } else if (event.key.keysym.sym == CHIP8_SAVE_KEY || event.key.keysym.sym == CHIP8_LOAD_KEY) {
+                    if (event.type == SDL_KEYDOWN) {
+                        bool *request = event.key.keysym.sym == CHIP8_SAVE_KEY ? &emu.save_state : &emu.load_state;
+                        __atomic_store_n(request, true, __ATOMIC_RELEASE);
+                        SDL_SemPost(emu.wake);
+                    }
+                } else if (chip8_handle_input(&emu.keys, &event)) {
+                    SDL_SemPost(emu.wake);
+                }
+                break;
+            }
+        }
+        if (__atomic_load_n(&emu.stopped, __ATOMIC_ACQUIRE)) quit = true;
+
+        // Present only when the emulation thread published a new frame
+        bool presented = false;
+        const uint64_t *frame_buffer = chip8_take_frame(&emu.frames);
+        if (frame_buffer != NULL || redraw) {
+            if (frame_buffer != NULL && !chip8_update_display(&display, frame_buffer, GREEN, BLACK)) quit = true;
+            if (!chip8_clear_background(renderer, BLACK))  quit = true;
+            if (!chip8_render_display(&display, renderer)) quit = true;
+            SDL_RenderPresent(renderer); // Present Frame with Changes
+            redraw    = false;
+            presented = true;
+        }
+        chip8_wait_next_frame(&pacer, presented);
+    }
+
+    __atomic_store_n(&emu.quit, true, __ATOMIC_RELEASE);
+    SDL_SemPost(emu.wake);
+    SDL_WaitThread(thread, NULL);
+    SDL_DestroySemaphore(emu.wake);
+    chip8_rewind_free(&rewind);
+
+    if (emu.movie != NULL) chip8_movie_record(&movie, cpu.chip8_cycles, movie.keys);
+    if (record_path != NULL && chip8_movie_write(&movie, record_path)) {
+        fprintf(stdout, "[INFO] Movie of cycles %lu to %lu written to `%s`\n", (unsigned long)movie.start_cycle,
+                (unsigned long)movie.end_cycle, record_path);
+    }
+    chip8_movie_free(&movie);
+
+    if (emu.status != CHIP8_OK) {
+        fprintf(stderr, "[INFO] %s at PC 0X%03X\n", chip8_status_name(emu.status), cpu.chip8_pc);
+    }
+    fprintf(stdout, "[INFO] Ran %lu cycles, %lu dropped, %lu late\n", (unsigned long)cpu.chip8_cycles,
+            (unsigned long)emu.sched.dropped_cycles, (unsigned long)emu.sched.late_cycles);
+    chip8_profile_report(&cpu, stdout, CHIP8_PROFILE_TOP);
+    if (trace_path != NULL) {
+        chip8_tracer_flush(&tracer, trace_path, emu.status);
+        chip8_tracer_free(&tracer);
+    }
+
+    // Cleanup
+    SDL_CloseAudioDevice(sound.dev);
+    fprintf(stdout, "[INFO] Audio: %lu underruns, %lu samples dropped\n",
+            (unsigned long)sound.underruns, (unsigned long)sound.ring.dropped);
+    SDL_DestroyTexture(display.texture);
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 0;
+#endif // CHIP8_NO_SDL
+}
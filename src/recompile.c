@@ -0,0 +1,369 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include "chip8.h"
+
+// Translates a program to a C file that runs it without an interpreter loop. Starting at
+// CHIP8_PROGRAM_ENTRY it follows jumps, both ways of every skip, and every 2NNN into its
+// subroutine and on to the return address, and gives each instruction it reaches a label.
+// Direct jumps and skips become gotos, 00EE and anything else that loads PC goes through a
+// switch over the labels. Every translated instruction first checks that its two bytes in RAM
+// are still the ones it was translated from, so code the program rewrote, and code the walk
+// never reached, run on chip8_execute_cached instead.
+//
+// The generated file only needs chip8.h and libchip8 for drawing, BCD/load/store and CXKK:
+//
+//     const Chip8_Aot chip8_aot_<name>;   // pass it to chip8_aot_attach
+
+static bool chip8_code[CHIP8_RAM_CAP]; // Addresses that get a label
+
+static void chip8_recompile_usage(const char *program_name)
+{
+    fprintf(stderr, "[Usage] %s [--name <identifier>] [-o <out.c>] <rom>\n", program_name);
+    fprintf(stderr, "    --name <identifier>  Emit chip8_aot_<identifier> (default `program`)\n");
+    fprintf(stderr, "    -o <out.c>           Write the translation here instead of stdout\n");
+}
+
+static uint16_t chip8_recompile_opcode(const Chip8_CPU *cpu, uint16_t loc)
+{
+    return (uint16_t)(cpu->chip8_memory[loc] << 8 | cpu->chip8_memory[loc + 1]);
+}
+
+// Mark every instruction reachable from CHIP8_PROGRAM_ENTRY, returns how many there are
+static size_t chip8_recompile_walk(const Chip8_CPU *cpu)
+{
+    static uint16_t pending[CHIP8_RAM_CAP * 2];
+    size_t count = 0;
+    size_t top = 0;
+    uint32_t end = CHIP8_PROGRAM_ENTRY + cpu->chip8_rom_size;
+
+    pending[top++] = CHIP8_PROGRAM_ENTRY;
+    while (top > 0) {
+        uint16_t loc = pending[--top];
+        if (loc < CHIP8_PROGRAM_ENTRY || loc + 2u > end || chip8_code[loc]) continue;
+
+        Chip8_Instr in;
+        chip8_decode(chip8_recompile_opcode(cpu, loc), &in);
+        // Faults are left to the interpreter
+        if (in.op == CHIP8_OP_UNKNOWN) continue;
+        chip8_code[loc] = true;
+        count++;
+
+        switch (in.op) {
+        case CHIP8_OP_JP:
+            pending[top++] = in.nnn;
+            break;
+        case CHIP8_OP_CALL:
+            pending[top++] = in.nnn;
+            pending[top++] = loc + 2;
+            break;
+        case CHIP8_OP_RET:
+            break;
+        case CHIP8_OP_SE_BYTE:
+        case CHIP8_OP_SNE_BYTE:
+        case CHIP8_OP_SNE_REG:
+        case CHIP8_OP_SKP:
+            pending[top++] = loc + 2;
+            pending[top++] = loc + 4;
+            break;
+        default:
+            pending[top++] = loc + 2;
+            break;
+        }
+    }
+    return count;
+}
+
+// Continue at `target`: a goto when it has a label, the dispatch switch otherwise
+static void chip8_recompile_goto(FILE *out, uint16_t target)
+{
+    if (target < CHIP8_RAM_CAP && chip8_code[target]) {
+        fprintf(out, "goto L_%03X;", target);
+    } else {
+        fprintf(out, "{ cpu->chip8_pc = 0x%03X; goto dispatch; }", target);
+    }
+}
+
+// Leave the instruction at `loc` for the one after it, falling through when that is the next label
+static void chip8_recompile_next(FILE *out, uint16_t loc, uint16_t next_label)
+{
+    if (loc + 2 == next_label) return;
+    fprintf(out, "    ");
+    chip8_recompile_goto(out, loc + 2);
+    fprintf(out, "\n");
+}
+
+static void chip8_recompile_skip(FILE *out, const char *condition, uint16_t loc, uint16_t next_label)
+{
+    fprintf(out, "    if (%s) ", condition);
+    chip8_recompile_goto(out, loc + 4);
+    fprintf(out, "\n");
+    chip8_recompile_next(out, loc, next_label);
+}
+
+// A call into libchip8 that may fail, with PC past the instruction as the engines have it
+static void chip8_recompile_helper(FILE *out, uint16_t loc, const char *call)
+{
+    fprintf(out, "    cpu->chip8_pc = 0x%03X;\n", loc + 2);
+    fprintf(out, "    status = %s;\n", call);
+    fprintf(out, "    if (status != CHIP8_OK) goto fail;\n");
+}
+
+// Same bodies as chip8_ops.h, with the operands filled in
+static void chip8_recompile_instr(FILE *out, const Chip8_CPU *cpu, uint16_t loc, uint16_t next_label)
+{
+    uint16_t opcode = chip8_recompile_opcode(cpu, loc);
+    Chip8_Instr in;
+    chip8_decode(opcode, &in);
+
+    char expr[128];
+    fprintf(out, "L_%03X: // %04X %s\n", loc, opcode, chip8_op_name((Chip8_Op)in.op));
+    fprintf(out, "    CHIP8_AOT_ENTER(0x%03X, 0x%04X);\n", loc, opcode);
+
+    switch (in.op) {
+    case CHIP8_OP_CLS:
+        fprintf(out, "    chip8_clear_display(cpu);\n");
+        break;
+    case CHIP8_OP_RET:
+        chip8_recompile_helper(out, loc, "chip8_op_return(cpu)");
+        fprintf(out, "    goto dispatch;\n\n");
+        return;
+    case CHIP8_OP_JP:
+        fprintf(out, "    ");
+        chip8_recompile_goto(out, in.nnn);
+        fprintf(out, "\n\n");
+        return;
+    case CHIP8_OP_CALL:
+        snprintf(expr, sizeof(expr), "chip8_op_call(cpu, 0x%03X)", in.nnn);
+        chip8_recompile_helper(out, loc, expr);
+        fprintf(out, "    ");
+        chip8_recompile_goto(out, in.nnn);
+        fprintf(out, "\n\n");
+        return;
+    case CHIP8_OP_SE_BYTE:
+        snprintf(expr, sizeof(expr), "cpu->chip8_vregs[0x%X] == 0x%02X", in.x, in.kk);
+        chip8_recompile_skip(out, expr, loc, next_label);
+        fprintf(out, "\n");
+        return;
+    case CHIP8_OP_SNE_BYTE:
+        snprintf(expr, sizeof(expr), "cpu->chip8_vregs[0x%X] != 0x%02X", in.x, in.kk);
+        chip8_recompile_skip(out, expr, loc, next_label);
+        fprintf(out, "\n");
+        return;
+    case CHIP8_OP_SNE_REG:
+        snprintf(expr, sizeof(expr), "cpu->chip8_vregs[0x%X] != cpu->chip8_vregs[0x%X]", in.x, in.y);
+        chip8_recompile_skip(out, expr, loc, next_label);
+        fprintf(out, "\n");
+        return;
+    case CHIP8_OP_SKP:
+        snprintf(expr, sizeof(expr), "cpu->chip8_key_state[cpu->chip8_vregs[0x%X] & 0xF]", in.x);
+        chip8_recompile_skip(out, expr, loc, next_label);
+        fprintf(out, "\n");
+        return;
+    case CHIP8_OP_LD_BYTE:
+        fprintf(out, "    cpu->chip8_vregs[0x%X] = 0x%02X;\n", in.x, in.kk);
+        break;
+    case CHIP8_OP_ADD_BYTE:
+        fprintf(out, "    cpu->chip8_vregs[0x%X] += 0x%02X;\n", in.x, in.kk);
+        break;
+    case CHIP8_OP_LD_REG:
+        fprintf(out, "    cpu->chip8_vregs[0x%X] = cpu->chip8_vregs[0x%X];\n", in.x, in.y);
+        break;
+    case CHIP8_OP_OR:
+        fprintf(out, "    cpu->chip8_vregs[0x%X] |= cpu->chip8_vregs[0x%X];\n", in.x, in.y);
+        break;
+    case CHIP8_OP_AND:
+        fprintf(out, "    cpu->chip8_vregs[0x%X] &= cpu->chip8_vregs[0x%X];\n", in.x, in.y);
+        break;
+    case CHIP8_OP_XOR:
+        fprintf(out, "    cpu->chip8_vregs[0x%X] ^= cpu->chip8_vregs[0x%X];\n", in.x, in.y);
+        break;
+    case CHIP8_OP_ADD_REG:
+        fprintf(out, "    value = (uint16_t)cpu->chip8_vregs[0x%X] + (uint16_t)cpu->chip8_vregs[0x%X];\n", in.x, in.y);
+        fprintf(out, "    cpu->chip8_vregs[0xF] = value > UINT8_MAX;\n");
+        fprintf(out, "    cpu->chip8_vregs[0x%X] = value & 0xFF;\n", in.x);
+        break;
+    case CHIP8_OP_SUB:
+        fprintf(out, "    cpu->chip8_vregs[0xF] = cpu->chip8_vregs[0x%X] > cpu->chip8_vregs[0x%X];\n", in.x, in.y);
+        fprintf(out, "    cpu->chip8_vregs[0x%X] -= cpu->chip8_vregs[0x%X];\n", in.x, in.y);
+        break;
+    case CHIP8_OP_SHR:
+        fprintf(out, "    cpu->chip8_vregs[0xF] = cpu->chip8_vregs[0x%X] & 0x01;\n", in.x);
+        fprintf(out, "    cpu->chip8_vregs[0x%X] >>= 1;\n", in.x);
+        break;
+    case CHIP8_OP_SUBN:
+        fprintf(out, "    cpu->chip8_vregs[0xF] = cpu->chip8_vregs[0x%X] > cpu->chip8_vregs[0x%X];\n", in.y, in.x);
+        fprintf(out, "    cpu->chip8_vregs[0x%X] = cpu->chip8_vregs[0x%X] - cpu->chip8_vregs[0x%X];\n", in.x, in.y, in.x);
+        break;
+    case CHIP8_OP_SHL:
+        fprintf(out, "    cpu->chip8_vregs[0xF] = (cpu->chip8_vregs[0x%X] & 0x80) != 0;\n", in.x);
+        fprintf(out, "    cpu->chip8_vregs[0x%X] <<= 1;\n", in.x);
+        break;
+    case CHIP8_OP_LD_I:
+        fprintf(out, "    cpu->chip8_ir = 0x%03X;\n", in.nnn);
+        break;
+    case CHIP8_OP_RND:
+        fprintf(out, "    cpu->chip8_vregs[0x%X] = chip8_op_random(cpu, 0x%02X);\n", in.x, in.kk);
+        break;
+    case CHIP8_OP_DRW:
+        snprintf(expr, sizeof(expr), "chip8_op_draw(cpu, 0x%X, 0x%X, %u)", in.x, in.y, in.n);
+        chip8_recompile_helper(out, loc, expr);
+        break;
+    case CHIP8_OP_LD_VX_DT:
+        fprintf(out, "    cpu->chip8_vregs[0x%X] = cpu->chip8_d_timer;\n", in.x);
+        break;
+    case CHIP8_OP_LD_KEY:
+        // Steps PC back onto itself while no key is held
+        fprintf(out, "    cpu->chip8_pc = 0x%03X;\n", loc + 2);
+        fprintf(out, "    chip8_op_wait_key(cpu, 0x%X);\n", in.x);
+        fprintf(out, "    goto dispatch;\n\n");
+        return;
+    case CHIP8_OP_LD_DT:
+        fprintf(out, "    cpu->chip8_d_timer = cpu->chip8_vregs[0x%X];\n", in.x);
+        break;
+    case CHIP8_OP_LD_ST:
+        fprintf(out, "    cpu->chip8_s_timer = cpu->chip8_vregs[0x%X];\n", in.x);
+        break;
+    case CHIP8_OP_ADD_I:
+        fprintf(out, "    cpu->chip8_ir += cpu->chip8_vregs[0x%X];\n", in.x);
+        break;
+    case CHIP8_OP_LD_F:
+        fprintf(out, "    cpu->chip8_ir = cpu->chip8_vregs[0x%X];\n", in.x);
+        break;
+    case CHIP8_OP_LD_BCD:
+        snprintf(expr, sizeof(expr), "chip8_op_bcd(cpu, 0x%X)", in.x);
+        chip8_recompile_helper(out, loc, expr);
+        break;
+    case CHIP8_OP_LD_STORE:
+        snprintf(expr, sizeof(expr), "chip8_op_store(cpu, 0x%X)", in.x);
+        chip8_recompile_helper(out, loc, expr);
+        break;
+    case CHIP8_OP_LD_LOAD:
+        snprintf(expr, sizeof(expr), "chip8_op_load(cpu, 0x%X)", in.x);
+        chip8_recompile_helper(out, loc, expr);
+        break;
+    default:
+        // chip8_recompile_walk doesn't label anything else, hand it to the interpreter all the same
+        fprintf(out, "    remaining++;\n");
+        fprintf(out, "    cpu->chip8_pc = 0x%03X;\n", loc);
+        fprintf(out, "    goto interpret;\n\n");
+        return;
+    }
+    chip8_recompile_next(out, loc, next_label);
+    fprintf(out, "\n");
+}
+
+static void chip8_recompile_emit(FILE *out, const Chip8_CPU *cpu, const char *rom_path, const char *name, size_t count)
+{
+    fprintf(out, "// Generated by chip8-recompile from %s, %zu instructions. Do not edit.\n", rom_path, count);
+    fprintf(out, "#include <stdint.h>\n\n#include \"chip8.h\"\n\n");
+    fprintf(out, "// Out of budget, or the program rewrote this instruction: let the interpreter have it\n");
+    fprintf(out, "#define CHIP8_AOT_ENTER(loc, opcode)                                                     \\\n");
+    fprintf(out, "    if (remaining == 0 ||                                                                \\\n");
+    fprintf(out, "        (cpu->chip8_memory[(loc)] << 8 | cpu->chip8_memory[(loc) + 1]) != (opcode)) {   \\\n");
+    fprintf(out, "        cpu->chip8_pc = (loc);                                                           \\\n");
+    fprintf(out, "        goto interpret;                                                                  \\\n");
+    fprintf(out, "    }                                                                                    \\\n");
+    fprintf(out, "    remaining--\n\n");
+
+    fprintf(out, "static Chip8_Status chip8_aot_%s_run(Chip8_CPU *cpu, uint64_t n)\n{\n", name);
+    fprintf(out, "    uint64_t remaining = n;\n");
+    fprintf(out, "    Chip8_Status status = CHIP8_OK;\n");
+    fprintf(out, "    uint16_t value = 0;\n");
+    fprintf(out, "    (void) value;\n\n");
+
+    fprintf(out, "dispatch:\n");
+    fprintf(out, "    switch (cpu->chip8_pc) {\n");
+    for (uint32_t loc = 0; loc < CHIP8_RAM_CAP; ++loc) {
+        if (chip8_code[loc]) fprintf(out, "    case 0x%03X: goto L_%03X;\n", loc, loc);
+    }
+    fprintf(out, "    default: goto interpret;\n");
+    fprintf(out, "    }\n\n");
+
+    fprintf(out, "interpret:\n");
+    fprintf(out, "    if (remaining == 0) goto done;\n");
+    fprintf(out, "    remaining--;\n");
+    fprintf(out, "    status = chip8_execute_cached(cpu);\n");
+    fprintf(out, "    if (status != CHIP8_OK) goto fail;\n");
+    fprintf(out, "    goto dispatch;\n\n");
+
+    for (uint32_t loc = 0; loc < CHIP8_RAM_CAP; ++loc) {
+        if (!chip8_code[loc]) continue;
+        uint32_t next = loc + 1;
+        while (next < CHIP8_RAM_CAP && !chip8_code[next]) next++;
+        chip8_recompile_instr(out, cpu, (uint16_t)loc, (uint16_t)next);
+    }
+
+    fprintf(out, "fail:\n");
+    fprintf(out, "    remaining++; // The failing instruction doesn't count\n");
+    fprintf(out, "done:\n");
+    fprintf(out, "    cpu->chip8_cycles += n - remaining;\n");
+    fprintf(out, "    return status;\n");
+    fprintf(out, "}\n\n");
+
+    fprintf(out, "const Chip8_Aot chip8_aot_%s = { %u, 0x%08X, chip8_aot_%s_run };\n",
+            name, cpu->chip8_rom_size, cpu->chip8_rom_hash, name);
+}
+
+int main(int argc, char **argv)
+{
+    const char *program_name = argv[0];
+    const char *name = "program";
+    const char *out_path = NULL;
+    const char *rom_path = NULL;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+            name = argv[++i];
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (rom_path == NULL && strncmp(argv[i], "-", 1) != 0) {
+            rom_path = argv[i];
+        } else {
+            chip8_recompile_usage(program_name);
+            return 1;
+        }
+    }
+    if (rom_path == NULL) {
+        chip8_recompile_usage(program_name);
+        return 1;
+    }
+    for (const char *c = name; *c != '\0'; ++c) {
+        if (!isalnum((unsigned char)*c) && *c != '_') {
+            fprintf(stderr, "[ERROR] `%s` is not a C identifier\n", name);
+            return 1;
+        }
+    }
+
+    static Chip8_CPU cpu;
+    chip8_reset(&cpu);
+    if (!chip8_read_file_into_memory(&cpu, rom_path)) return 1;
+    size_t count = chip8_recompile_walk(&cpu);
+
+    FILE *out = stdout;
+    if (out_path != NULL) {
+        out = fopen(out_path, "w");
+        if (out == NULL) {
+            fprintf(stderr, "[ERROR] Could not write `%s`: `%s`\n", out_path, strerror(errno));
+            return 1;
+        }
+    }
+    chip8_recompile_emit(out, &cpu, rom_path, name, count);
+
+    if (out_path != NULL) {
+        bool ok = !ferror(out);
+        if (fclose(out) != 0) ok = false;
+        if (!ok) {
+            fprintf(stderr, "[ERROR] Could not write `%s`: `%s`\n", out_path, strerror(errno));
+            return 1;
+        }
+        printf("[INFO] Translated %zu instructions reachable from 0x%03X into `%s`\n",
+               count, CHIP8_PROGRAM_ENTRY, out_path);
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "chip8.h"
+
+// Turns a trace file written by chip8_tracer_flush into one line per instruction:
+//   <cycle> <pc> <opcode> <mnemonic> I=<i> [Vx=<value> for every register the instruction changed]
+
+static void chip8_trace_usage(const char *program_name)
+{
+    fprintf(stderr, "[Usage] %s [--last <n>] <trace_path>\n", program_name);
+    fprintf(stderr, "    --last <n>  Only print the last <n> instructions\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *program_name = argv[0];
+    const char *trace_path = NULL;
+    uint64_t last = UINT64_MAX;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--last") == 0 && i + 1 < argc) {
+            const char *value = argv[++i];
+            char *end = NULL;
+            errno = 0;
+            last = strtoull(value, &end, 10);
+            if (errno != 0 || *value == '\0' || *value == '-' || *end != '\0') {
+                fprintf(stderr, "[ERROR] Invalid instruction count `%s`\n", value);
+                return 1;
+            }
+        } else if (trace_path == NULL) {
+            trace_path = argv[i];
+        } else {
+            chip8_trace_usage(program_name);
+            return 1;
+        }
+    }
+    if (trace_path == NULL) {
+        chip8_trace_usage(program_name);
+        return 1;
+    }
+
+    FILE *fp = fopen(trace_path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "[ERROR] Could not read `%s`: `%s`\n", trace_path, strerror(errno));
+        return 1;
+    }
+
+    Chip8_Trace_Header header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, CHIP8_TRACE_MAGIC, 4) != 0) {
+        fprintf(stderr, "[ERROR] `%s` is not a CHIP-8 trace\n", trace_path);
+        fclose(fp);
+        return 1;
+    }
+    if (header.version != CHIP8_TRACE_VERSION || header.record_size != sizeof(Chip8_Trace_Record)) {
+        fprintf(stderr, "[ERROR] `%s` is trace version %u with %u byte records, expected version %u with %u\n",
+                trace_path, header.version, header.record_size,
+                CHIP8_TRACE_VERSION, (unsigned)sizeof(Chip8_Trace_Record));
+        fclose(fp);
+        return 1;
+    }
+
+    uint64_t skip = header.count > last ? header.count - last : 0;
+    if (skip > 0 && fseek(fp, (long)(skip * sizeof(Chip8_Trace_Record)), SEEK_CUR) != 0) {
+        fprintf(stderr, "[ERROR] Could not seek in `%s`: `%s`\n", trace_path, strerror(errno));
+        fclose(fp);
+        return 1;
+    }
+
+    fprintf(stdout, "# %lu instructions, %lu older ones overwritten\n",
+            (unsigned long)header.count, (unsigned long)(header.overwritten + skip));
+
+    Chip8_Trace_Record record;
+    uint64_t read = 0;
+    while (fread(&record, sizeof(record), 1, fp) == 1) {
+        Chip8_Instr instr;
+        chip8_decode(record.opcode, &instr);
+        read++;
+
+        fprintf(stdout, "%10lu  0X%03X  %04X  %-22s I=0X%03X",
+                (unsigned long)record.cycle, record.pc, record.opcode, chip8_op_name(instr.op), record.ir);
+        for (uint8_t x = 0; x < CHIP8_VREG_COUNT; ++x) {
+            if (record.changed & (1u << x)) fprintf(stdout, "  V%X=0X%02X", x, record.vregs[x]);
+        }
+        fputc('\n', stdout);
+    }
+    fclose(fp);
+
+    if (read != header.count - skip) {
+        fprintf(stderr, "[ERROR] `%s` is truncated: %lu of %lu records\n",
+                trace_path, (unsigned long)read, (unsigned long)(header.count - skip));
+        return 1;
+    }
+    if (header.status != CHIP8_OK) {
+        fprintf(stdout, "# Stopped on the last instruction: %s\n", chip8_status_name((Chip8_Status)header.status));
+    }
+    return 0;
+}